@@ -9,14 +9,66 @@
 #include <variant>
 #include <optional>
 #include <vector>
+#include <memory>
+#include <memory_resource>
 #include <array>
+#include <tuple>
+#include <cstdint>
+#include <cmath>
+#include <bit>
+#include <algorithm>
+#include <typeinfo>
+#include <unordered_map>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(ZS_INSTRUMENT)
+#include <atomic>
+#include <cstdlib>
+#include <list>
+#include <malloc.h>
+#include <mutex>
+#include <new>
+#endif
+
+// byte order of scalars on the wire: little, big or native, a stream may override it with a static endian member
+#ifndef ZS_WIRE_ENDIAN
+#define ZS_WIRE_ENDIAN little
+#endif
+
+// replaces the global operator new/delete to feed zs::Instrumentation, expand it in one translation unit
+// every replaceable form is covered so nothing allocated by one family is freed by another
+#if defined(ZS_INSTRUMENT)
+#define ZS_COUNTING_NEW\
+	void* operator new(size_t size) { return zs::CountedNew(size, 0); }\
+	void* operator new[](size_t size) { return zs::CountedNew(size, 0); }\
+	void* operator new(size_t size, std::align_val_t align) { return zs::CountedNew(size, size_t(align)); }\
+	void* operator new[](size_t size, std::align_val_t align) { return zs::CountedNew(size, size_t(align)); }\
+	void* operator new(size_t size, const std::nothrow_t&) noexcept { return zs::CountedAllocate(size, 0); }\
+	void* operator new[](size_t size, const std::nothrow_t&) noexcept { return zs::CountedAllocate(size, 0); }\
+	void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return zs::CountedAllocate(size, size_t(align)); }\
+	void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return zs::CountedAllocate(size, size_t(align)); }\
+	void operator delete(void* p) noexcept { zs::CountedFree(p); }\
+	void operator delete[](void* p) noexcept { zs::CountedFree(p); }\
+	void operator delete(void* p, size_t) noexcept { zs::CountedFree(p); }\
+	void operator delete[](void* p, size_t) noexcept { zs::CountedFree(p); }\
+	void operator delete(void* p, std::align_val_t) noexcept { zs::CountedFree(p); }\
+	void operator delete[](void* p, std::align_val_t) noexcept { zs::CountedFree(p); }\
+	void operator delete(void* p, size_t, std::align_val_t) noexcept { zs::CountedFree(p); }\
+	void operator delete[](void* p, size_t, std::align_val_t) noexcept { zs::CountedFree(p); }\
+	void operator delete(void* p, const std::nothrow_t&) noexcept { zs::CountedFree(p); }\
+	void operator delete[](void* p, const std::nothrow_t&) noexcept { zs::CountedFree(p); }\
+	void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { zs::CountedFree(p); }\
+	void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { zs::CountedFree(p); }
+#else
+#define ZS_COUNTING_NEW
+#endif
 
 #define ZS_READ(type, in, name)\
-		type name;\
-		if(auto temp = Read<type>(in); std::holds_alternative<Error>(temp))\
-			return Error{};\
-		else\
-			name = std::get<type>(temp);
+		auto name##Result = Read<type>(in);\
+		if(std::holds_alternative<Error>(name##Result))\
+			return std::move(std::get<Error>(name##Result));\
+		auto& name = std::get<type>(name##Result);
 
 namespace zs
 {
@@ -27,12 +79,12 @@ namespace zs
 	}
 
 	template<typename T>
-	concept POD = std::is_pod_v<T>;
+	concept POD = std::is_standard_layout_v<T> && std::is_trivial_v<T>;
 
 	template<typename T>
 	constexpr bool String_ = false;
-	template<typename T>
-	constexpr bool String_<std::basic_string<T>> = true;
+	template<typename T, typename Traits, typename Allocator>
+	constexpr bool String_<std::basic_string<T, Traits, Allocator>> = true;
 	template<typename T>
 	concept String = String_<T>;
 
@@ -52,8 +104,8 @@ namespace zs
 
 	template<typename T>
 	constexpr bool Vector_ = false;
-	template<typename T>
-	constexpr bool Vector_<std::vector<T>> = true;
+	template<typename T, typename Allocator>
+	constexpr bool Vector_<std::vector<T, Allocator>> = true;
 	template<typename T>
 	concept Vector = Vector_<T>;
 
@@ -76,6 +128,147 @@ namespace zs
 	template<typename T, typename In>
 	concept DefinedReadTrait = requires (In in, T t){ Trait<T>::Read(in); };
 
+	template<typename Out>
+	concept BitOut = requires (Out out){ out.WriteBits(uint64_t{}, size_t{}); };
+
+	template<typename In>
+	concept BitIn = requires (In in, uint64_t value){ { in.ReadBits(value, size_t{}) } -> Same<bool>; };
+
+	// WriteRef is handed contiguous values straight from the object being written, they stay alive as long as it does
+	template<typename Out>
+	concept RefOut = requires (Out out, const void* source){ out.WriteRef(source, size_t{}); };
+
+	// streams that write repeated strings once and refer back to them, see InterningWriter/InterningReader
+	template<typename Out>
+	concept InternOut = requires (Out out, std::string_view value){ out.WriteInterned(value); };
+
+	template<typename In>
+	concept InternIn = requires (In in, std::string_view value){ { in.ReadInterned(value) } -> Same<bool>; };
+
+	template<typename In>
+	concept Positioned = requires (In in){ { in.Position() } -> std::convertible_to<size_t>; };
+
+	template<typename T>
+	concept MemberPointer = std::is_member_object_pointer_v<T>;
+
+	template<typename T>
+	struct MemberPointerTrait;
+	template<typename C, typename M>
+	struct MemberPointerTrait<M C::*>
+	{
+		using Class = C;
+		using Type = M;
+	};
+
+	template<typename T, typename Member>
+	decltype(auto) Field(T& value, const Member& member)
+	{
+		if constexpr (MemberPointer<Member>)
+			return (value.*member);
+		else
+			return (value.*member.member);
+	}
+
+	template<typename T, typename Member>
+	using FieldType = std::decay_t<decltype(Field(std::declval<T&>(), std::declval<const Member&>()))>;
+
+	template<typename T>
+	concept Reflected = requires { Trait<T>::members; };
+
+	template<typename T>
+	constexpr size_t MemberCount = std::tuple_size_v<std::decay_t<decltype(Trait<T>::members)>>;
+
+	template<size_t bits>
+	using UnsignedFor =
+		std::conditional_t<bits <= 8, uint8_t,
+		std::conditional_t<bits <= 16, uint16_t,
+		std::conditional_t<bits <= 32, uint32_t, uint64_t>>>;
+
+	template<typename Stream>
+	constexpr std::endian WireEndian = []
+	{
+		if constexpr (requires { Stream::endian; })
+			return Stream::endian;
+		else
+			return std::endian::ZS_WIRE_ENDIAN;
+	}();
+
+	template<typename T>
+	constexpr bool Scalar = std::is_arithmetic_v<T> || std::is_enum_v<T>;
+
+	// scalars are reordered, as are the scalars inside arrays and inside POD structs with Trait<T>::members,
+	// POD structs without a Trait keep their in memory representation since their layout is unknown
+	template<typename T>
+	constexpr bool Swappable = []
+	{
+		if constexpr (Scalar<T>)
+			return sizeof(T) > 1;
+		else if constexpr (std::is_array_v<T>)
+			return Swappable<std::remove_extent_t<T>>;
+		else if constexpr (Array<T>)
+			return Swappable<typename T::value_type>;
+		else if constexpr (Reflected<T>)
+			return std::apply([](const auto&... members){return (Swappable<FieldType<T, decltype(members)>> || ...);}, Trait<T>::members);
+		else
+			return false;
+	}();
+
+	template<typename T, typename Stream>
+	constexpr bool NeedsSwap = Swappable<T> && WireEndian<Stream> != std::endian::native;
+
+	template<typename T>
+	T ByteSwap(T value)
+	{
+		unsigned char bytes[sizeof(T)];
+		std::memcpy(bytes, std::addressof(value), sizeof(T));
+		std::reverse(bytes, bytes + sizeof(T));
+		std::memcpy(std::addressof(value), bytes, sizeof(T));
+		return value;
+	}
+
+	// reverses the bytes of every scalar in place, member by member for arrays and Trait structs
+	template<typename T>
+	void SwapBytes(T& value)
+	{
+		if constexpr (Scalar<T>)
+			value = ByteSwap(value);
+		else if constexpr (std::is_array_v<T> || Array<T>)
+			for (auto& element : value)
+				SwapBytes(element);
+		else if constexpr (Reflected<T>)
+			ForEach(Trait<T>::members, [&value](auto member){SwapBytes(Field(value, member));});
+	}
+
+	template<typename T>
+	void ByteSwapRange(T* data, size_t count)
+	{
+		if constexpr (!Scalar<T>)
+		{
+			for (size_t i = 0; i < count; ++i)
+				SwapBytes(data[i]);
+		}
+		else
+		{
+			static_assert(sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8, "unsupported scalar size");
+			size_t i = 0;
+#if defined(__SSE2__)
+			// reorder the 16 bit words of each element with pshuflw/pshufhw, then swap the bytes of every word
+			constexpr int order = sizeof(T) == 4 ? _MM_SHUFFLE(2, 3, 0, 1) : _MM_SHUFFLE(0, 1, 2, 3);
+			auto bytes = reinterpret_cast<unsigned char*>(data);
+			for (; i + 16 / sizeof(T) <= count; i += 16 / sizeof(T))
+			{
+				auto p = reinterpret_cast<__m128i*>(bytes + i * sizeof(T));
+				__m128i v = _mm_loadu_si128(p);
+				if constexpr (sizeof(T) > 2)
+					v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, order), order);
+				_mm_storeu_si128(p, _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+			}
+#endif
+			for (; i < count; ++i)
+				data[i] = ByteSwap(data[i]);
+		}
+	}
+
 	struct StringWriter
 	{
 		void Write(const void* source, size_t bytes)
@@ -91,17 +284,225 @@ namespace zs
 		std::ostringstream os;
 	};
 
+	// appends into a plain string, avoiding the stream machinery of StringWriter
+	struct BufferWriter
+	{
+		void Write(const void* source, size_t bytes)
+		{
+			buffer.append(reinterpret_cast<const char*>(source), bytes);
+		}
+
+		std::string String() const
+		{
+			return buffer;
+		}
+
+		std::string buffer;
+	};
+
+	struct PoolStats
+	{
+		uint64_t acquired = 0;
+		uint64_t reused = 0;
+		uint64_t released = 0;
+		uint64_t discarded = 0;
+		size_t cached = 0;
+		size_t cachedBytes = 0;
+	};
+
+	// a per thread free list of buffers that keep their capacity, so steady state acquire and release never allocate
+	// buffers grown past maxBufferBytes, or released while maxCached are already cached, are freed instead
+	struct BufferPool
+	{
+		static std::string Acquire()
+		{
+			auto& pool = Local();
+			++pool.stats.acquired;
+			if (pool.buffers.empty())
+				return {};
+			++pool.stats.reused;
+			std::string buffer = std::move(pool.buffers.back());
+			pool.buffers.pop_back();
+			pool.stats.cachedBytes -= buffer.capacity();
+			return buffer;
+		}
+
+		static void Release(std::string&& buffer)
+		{
+			auto& pool = Local();
+			++pool.stats.released;
+			if (pool.buffers.size() >= maxCached || buffer.capacity() > maxBufferBytes)
+			{
+				++pool.stats.discarded;
+				return;
+			}
+			buffer.clear();
+			pool.stats.cachedBytes += buffer.capacity();
+			pool.buffers.push_back(std::move(buffer));
+		}
+
+		// statistics of the calling thread's pool
+		static PoolStats Stats()
+		{
+			auto& pool = Local();
+			pool.stats.cached = pool.buffers.size();
+			return pool.stats;
+		}
+
+		static void Clear()
+		{
+			auto& pool = Local();
+			pool.buffers.clear();
+			pool.stats = {};
+		}
+
+		static inline size_t maxCached = 64;
+		static inline size_t maxBufferBytes = 1 << 20;
+
+		struct LocalPool
+		{
+			LocalPool()
+			{
+				buffers.reserve(maxCached);
+			}
+
+			std::vector<std::string> buffers;
+			PoolStats stats;
+		};
+
+		static LocalPool& Local()
+		{
+			thread_local LocalPool pool;
+			return pool;
+		}
+	};
+
+	// a BufferWriter whose buffer comes from and returns to the calling thread's BufferPool
+	struct PooledWriter
+	{
+		PooledWriter():buffer(BufferPool::Acquire()){}
+
+		PooledWriter(const PooledWriter&) = delete;
+		PooledWriter& operator=(const PooledWriter&) = delete;
+
+		~PooledWriter()
+		{
+			BufferPool::Release(std::move(buffer));
+		}
+
+		void Write(const void* source, size_t bytes)
+		{
+			buffer.append(reinterpret_cast<const char*>(source), bytes);
+		}
+
+		std::string_view View() const
+		{
+			return buffer;
+		}
+
+		void Clear()
+		{
+			buffer.clear();
+		}
+
+		std::string buffer;
+	};
+
+	// discards the bytes and only counts them, for sizing a message before encoding it for real
+	struct SizeWriter
+	{
+		void Write(const void*, size_t bytes)
+		{
+			size += bytes;
+		}
+
+		size_t size = 0;
+	};
+
+	// packs values into a little endian bit stream, bits are buffered in a 64 bit word and handed to out a word at a time
+	// call Flush after the last write, byte sized writes on a byte boundary go straight to out
+	template<typename Out>
+	struct BitWriter
+	{
+		static constexpr std::endian endian = WireEndian<Out>;
+
+		BitWriter(Out& out):out_(out){}
+
+		void WriteBits(uint64_t value, size_t bits)
+		{
+			if (bits < 64)
+				value &= (uint64_t(1) << bits) - 1;
+			word_ |= value << used_;
+			used_ += bits;
+			if (used_ < 64)
+				return;
+
+			unsigned char bytes[8];
+			for (size_t i = 0; i < 8; ++i)
+				bytes[i] = static_cast<unsigned char>(word_ >> (i * 8));
+			out_.Write(bytes, 8);
+
+			used_ -= 64;
+			word_ = used_ ? value >> (bits - used_) : 0;
+		}
+
+		void Write(const void* source, size_t bytes)
+		{
+			if (used_ % 8 == 0)
+			{
+				Flush();
+				out_.Write(source, bytes);
+				return;
+			}
+
+			auto p = static_cast<const unsigned char*>(source);
+			for (; bytes >= 8; p += 8, bytes -= 8)
+			{
+				uint64_t word = 0;
+				for (size_t i = 0; i < 8; ++i)
+					word |= uint64_t(p[i]) << (i * 8);
+				WriteBits(word, 64);
+			}
+			for (; bytes > 0; ++p, --bytes)
+				WriteBits(*p, 8);
+		}
+
+		void Flush()
+		{
+			unsigned char bytes[8];
+			size_t count = (used_ + 7) / 8;
+			for (size_t i = 0; i < count; ++i)
+				bytes[i] = static_cast<unsigned char>(word_ >> (i * 8));
+			if (count > 0)
+				out_.Write(bytes, count);
+			word_ = 0;
+			used_ = 0;
+		}
+
+		Out& out_;
+		uint64_t word_ = 0;
+		size_t used_ = 0;
+	};
+
 	template<typename T, typename Out>
 	void Write(Out& out, const T& value);
 
+	template<typename Out, typename T, typename Member>
+	void WriteField(Out& out, const T& value, const Member& member)
+	{
+		if constexpr (MemberPointer<Member>)
+			Write(out, value.*member);
+		else
+			member.Write(out, value.*member.member);
+	}
+
 	template<typename T>
 	struct WriteMembers
 	{
 		template<typename Out>
 		static void Write(Out& out, const T& value)
 		{
-			using zs::Write;
-			std::apply([&out, &value](auto&&... args){(Write(out, value.*args), ...);}, Trait<T>::members);
+			std::apply([&out, &value](auto&&... args){(WriteField(out, value, args), ...);}, Trait<T>::members);
 		}
 	};
 	
@@ -115,6 +516,30 @@ namespace zs
 		}
 	};
 
+	template<typename T, typename Out>
+	void WriteScalars(Out& out, const T* data, size_t count)
+	{
+		if constexpr (NeedsSwap<T, Out>)
+		{
+			T swapped[256];
+			for (size_t i = 0; i < count; i += 256)
+			{
+				size_t n = std::min<size_t>(256, count - i);
+				std::memcpy(swapped, data + i, n * sizeof(T));
+				ByteSwapRange(swapped, n);
+				out.Write(swapped, n * sizeof(T));
+			}
+		}
+		else if constexpr (RefOut<Out>)
+		{
+			out.WriteRef(data, count * sizeof(T));
+		}
+		else
+		{
+			out.Write(data, count * sizeof(T));
+		}
+	}
+
 	template<typename T, typename Out> requires DefinedWriteTrait<T, Out>
 	void Write(Out& out, const T& value)
 	{
@@ -124,7 +549,18 @@ namespace zs
 	template<POD T, typename Out>
 	void Write(Out& out, const T& value)
 	{
-		out.Write(std::addressof(value), sizeof(value));
+		if constexpr (Same<T, bool> && BitOut<Out>)
+			out.WriteBits(value, 1);
+		else if constexpr (Array<T>)
+			WriteScalars(out, value.data(), value.size());
+		else if constexpr (NeedsSwap<T, Out>)
+		{
+			T swapped = value;
+			SwapBytes(swapped);
+			out.Write(std::addressof(swapped), sizeof(swapped));
+		}
+		else
+			out.Write(std::addressof(value), sizeof(value));
 	}
 
 	template<Optional T, typename Out>
@@ -145,6 +581,8 @@ namespace zs
 	void Write(Out& out, const char* value)
 	{
 		size_t size = std::strlen(value);
+		if constexpr (InternOut<Out>)
+			return out.WriteInterned(std::string_view(value, size));
 		Write(out, size);
 		out.Write(value, size);
 	}
@@ -153,12 +591,14 @@ namespace zs
 		requires (Vector<T>&& POD<typename T::value_type>) || String<T> || StringView<T>
 	void Write(Out& out, const T& value)
 	{
+		if constexpr (InternOut<Out> && (String<T> || StringView<T>) && Same<typename T::value_type, char>)
+			return out.WriteInterned(std::string_view(value.data(), value.size()));
 		Write(out, value.size());
-		out.Write(value.data(), value.size() * sizeof(typename T::value_type));
+		WriteScalars(out, value.data(), value.size());
 	}
 
-	template<typename T, typename Out> requires (!POD<T>)
-	void Write(Out& out, const std::vector<T>& vec)
+	template<typename T, typename Allocator, typename Out> requires (!POD<T>)
+	void Write(Out& out, const std::vector<T, Allocator>& vec)
 	{
 		Write(out, vec.size());
 		for (const auto& v : vec)
@@ -179,133 +619,1440 @@ namespace zs
 		bool Read(void* dest, size_t bytes)
 		{
 			is.read(reinterpret_cast<char*>(dest), bytes);
-			return is.gcount() == bytes;
+			position += is.gcount();
+			return size_t(is.gcount()) == bytes;
+		}
+
+		size_t Position() const
+		{
+			return position;
 		}
 
 		std::istringstream is;
+		size_t position = 0;
 	};
 
-	struct Error {};
-
-	template<typename T, typename In>
-	std::variant<T, Error> Read(In& in);
-
-	template<typename T>
-	struct ReadMembers
+	// reads from memory it does not own, data must outlive the reader
+	struct BufferReader
 	{
-		template<typename In>
-		struct TryRead
-		{
-			TryRead(In& in, T& value, bool& failed)
-				:in_(in), v_(value), failed_(failed){}
-
-			bool& failed_;
-			In& in_;
-			T& v_;
+		BufferReader(std::string_view str):data(str){}
 
-			template<typename PointerToMember>
-			void operator()(PointerToMember member) const
+		bool Read(void* dest, size_t bytes)
+		{
+			if (bytes > data.size() - offset)
 			{
-				if(failed_)
-					return;
-				using Member = std::decay_t<decltype(std::declval<T>().*member)>;
-				using zs::Read;
-				auto temp=Read<Member>(in_);
-				if(std::holds_alternative<Error>(temp))
-				{
-					failed_=true;
-					return;
-				}
-				v_.*member=std::get<Member>(temp);
+				offset = data.size();
+				return false;
 			}
-		};
+			std::memcpy(dest, data.data() + offset, bytes);
+			offset += bytes;
+			return true;
+		}
 
-		template<typename In>
-		static std::variant<T, Error> Read(In& in)
+		size_t Position() const
 		{
-			T value;
-			bool failed = false;
-			ForEach(Trait<T>::members, TryRead(in, value, failed));
-			if(failed)
-				return Error{};
-			return value;
+			return offset;
 		}
+
+		std::string_view data;
+		size_t offset = 0;
 	};
 
-	template<typename T>
-	struct ReadBitwise
+	// attaches a memory resource to any reader, e.g. a monotonic arena so a whole message is released at once
+	template<typename In>
+	struct ResourceReader
 	{
-		template<typename In>
-		static std::variant<T, Error> Read(In& in)
+		static constexpr std::endian endian = WireEndian<In>;
+
+		ResourceReader(In& in, std::pmr::memory_resource* memory):in_(in), resource(memory){}
+
+		bool Read(void* dest, size_t bytes)
 		{
-			T value;
-			if (!in.Read(std::addressof(value), sizeof(value)))
-				return Error{};
-			return value;
+			return in_.Read(dest, bytes);
 		}
-	};
-
-	template<typename T, typename In> requires DefinedReadTrait<T, In>
-	std::variant<T, Error> Read(In& in)
-	{
-		return Trait<T>::Read(in);
-	}
 
-	template<POD T, typename In>
-	std::variant<T, Error> Read(In& in)
-	{
-		T value;
-		if (!in.Read(std::addressof(value), sizeof(value)))
-			return Error{};
-		return value;
-	}
+		bool ReadBits(uint64_t& value, size_t bits) requires BitIn<In>
+		{
+			return in_.ReadBits(value, bits);
+		}
 
-	template<Optional T, typename In>
-	std::variant<T, Error> Read(In& in)
-	{
-		ZS_READ(bool, in, hasValue);
-		if (!hasValue)
-			return std::nullopt;
-		ZS_READ(typename T::value_type, in, value);
-		return T(value);
-	}
+		bool ReadInterned(std::string_view& value) requires InternIn<In>
+		{
+			return in_.ReadInterned(value);
+		}
 
-	template<typename T, typename In>
-		requires (Vector<T>&& POD<typename T::value_type>) || String<T>
-	std::variant<T, Error> Read(In& in)
-	{
-		ZS_READ(size_t, in, size);
+		size_t Position() requires Positioned<In>
+		{
+			return in_.Position();
+		}
 
-		T value;
-		value.resize(size);
-		if (!in.Read(value.data(), value.size() * sizeof(typename T::value_type)))
-			return Error{};
-		return value;
-	}
+		In& in_;
+		std::pmr::memory_resource* resource;
+	};
 
-	template<typename T, typename In> requires (Vector<T> && !POD<typename T::value_type>)
-	std::variant<T, Error> Read(In& in)
+	// reads the stream produced by BitWriter, refills only as many bytes as the pending request needs so in is never over read
+	template<typename In>
+	struct BitReader
 	{
-		ZS_READ(size_t, in, size);
+		static constexpr std::endian endian = WireEndian<In>;
 
-		T vec;
-		for (size_t i = 0;i < size;++i)
+		BitReader(In& in):in_(in){}
+
+		bool ReadBits(uint64_t& value, size_t bits)
 		{
-			ZS_READ(typename T::value_type, in, v);
-			vec.emplace_back(std::move(v));
+			if (bits <= count_)
+			{
+				value = bits < 64 ? word_ & ((uint64_t(1) << bits) - 1) : word_;
+				word_ = bits < 64 ? word_ >> bits : 0;
+				count_ -= bits;
+				return true;
+			}
+
+			size_t missing = bits - count_;
+			size_t count = (missing + 7) / 8;
+			unsigned char bytes[8];
+			if (!in_.Read(bytes, count))
+				return false;
+			uint64_t fresh = 0;
+			for (size_t i = 0; i < count; ++i)
+				fresh |= uint64_t(bytes[i]) << (i * 8);
+
+			uint64_t low = missing < 64 ? fresh & ((uint64_t(1) << missing) - 1) : fresh;
+			value = word_ | (low << count_);
+			word_ = missing < 64 ? fresh >> missing : 0;
+			count_ = count * 8 - missing;
+			return true;
 		}
-		return vec;
-	}
 
-	template<typename T, typename In> requires (Array<T> && !POD<typename T::value_type>)
-	std::variant<T, Error> Read(In& in)
-	{
-		T arr;
-		for (size_t i = 0;i < arr.size();++i)
+		bool Read(void* dest, size_t bytes)
 		{
-			ZS_READ(typename T::value_type, in, v);
-			arr[i] = std::move(v);
+			if (count_ == 0)
+				return in_.Read(dest, bytes);
+
+			auto p = static_cast<unsigned char*>(dest);
+			uint64_t word;
+			for (; bytes >= 8; p += 8, bytes -= 8)
+			{
+				if (!ReadBits(word, 64))
+					return false;
+				for (size_t i = 0; i < 8; ++i)
+					p[i] = static_cast<unsigned char>(word >> (i * 8));
+			}
+			for (; bytes > 0; ++p, --bytes)
+			{
+				if (!ReadBits(word, 8))
+					return false;
+				*p = static_cast<unsigned char>(word);
+			}
+			return true;
 		}
-		return arr;
+
+		In& in_;
+		uint64_t word_ = 0;
+		size_t count_ = 0;
+	};
+
+	enum class ErrorKind : uint8_t
+	{
+		Invalid,
+		Truncated,
+		TooLarge,
+		Checksum,
+	};
+
+	// offset is where the stream was when the failure was detected, if the stream reports its Position
+	// the path leads from the value being read to the failing member, e.g. [3].pos.x, it is only allocated while a failed read unwinds
+	// so a variant holding an Error stays small
+	struct Error
+	{
+		static constexpr size_t unknownOffset = size_t(-1);
+
+		Error() = default;
+
+		Error(ErrorKind kind, size_t offset = unknownOffset)
+			:kind(kind), offset(offset){}
+
+		Error(const Error& other)
+			:kind(other.kind), offset(other.offset), path_(other.path_ ? std::make_unique<std::string>(*other.path_) : nullptr){}
+
+		Error(Error&&) noexcept = default;
+
+		Error& operator=(const Error& other)
+		{
+			if (this != &other)
+				*this = Error(other);
+			return *this;
+		}
+
+		Error& operator=(Error&&) noexcept = default;
+
+		std::string_view Path() const
+		{
+			return path_ ? std::string_view(*path_) : std::string_view();
+		}
+
+		// prepends a member name or an [index] to the path
+		void Within(std::string_view segment)
+		{
+			if (!path_)
+				path_ = std::make_unique<std::string>();
+			if (!path_->empty() && path_->front() != '[')
+				path_->insert(path_->begin(), '.');
+			path_->insert(0, segment);
+		}
+
+		std::string Message() const
+		{
+			constexpr const char* kinds[] = { "invalid data", "truncated input", "size over limit", "checksum mismatch" };
+			std::string message = kinds[size_t(kind)];
+			if (offset != unknownOffset)
+				message += " at byte " + std::to_string(offset);
+			if (path_)
+				message += " in " + *path_;
+			return message;
+		}
+
+		ErrorKind kind = ErrorKind::Invalid;
+		size_t offset = unknownOffset;
+		std::unique_ptr<std::string> path_;
+	};
+
+	template<typename In>
+	size_t PositionOf(In& in)
+	{
+		if constexpr (Positioned<In>)
+			return in.Position();
+		else
+			return Error::unknownOffset;
+	}
+
+	template<typename In>
+	Error Fail(In& in, ErrorKind kind)
+	{
+		return Error{ kind, PositionOf(in) };
+	}
+
+	template<typename T>
+	std::string MemberName(size_t index);
+
+	template<typename In>
+	concept ResourceIn = requires (In in){ { in.resource } -> std::convertible_to<std::pmr::memory_resource*>; };
+
+	// allocator aware values read from a stream carrying a memory resource allocate from it, nested containers included
+	template<typename T, typename In>
+	T Construct(In& in)
+	{
+		if constexpr (ResourceIn<In> && std::uses_allocator_v<T, std::pmr::polymorphic_allocator<std::byte>>)
+			return std::make_obj_using_allocator<T>(std::pmr::polymorphic_allocator<std::byte>(in.resource));
+		else
+			return T();
+	}
+
+	template<typename T, typename In>
+	std::variant<T, Error> Read(In& in);
+
+	// reads into a value the caller owns, false on failure with the details left in LastError
+	template<typename T, typename In>
+	bool Read(In& in, T& value);
+
+	// details of the last failed bool Read on this thread, only touched on the failure path
+	inline Error& LastError()
+	{
+		thread_local Error error;
+		return error;
+	}
+
+	inline bool Failed(Error error)
+	{
+		LastError() = std::move(error);
+		return false;
+	}
+
+	template<typename In>
+	bool Failed(In& in, ErrorKind kind)
+	{
+		return Failed(Fail(in, kind));
+	}
+
+	// prepends a member name or an [index] to the path of the last failure while it unwinds
+	inline bool FailedWithin(std::string_view segment)
+	{
+		LastError().Within(segment);
+		return false;
+	}
+
+	template<typename T, typename In, typename Member>
+	bool ReadField(In& in, T& value, const Member& member)
+	{
+		if constexpr (MemberPointer<Member>)
+			return Read(in, Field(value, member));
+		else
+		{
+			auto temp = member.Read(in);
+			if (std::holds_alternative<Error>(temp))
+				return Failed(std::move(std::get<Error>(temp)));
+			Field(value, member) = std::move(std::get<FieldType<T, Member>>(temp));
+			return true;
+		}
+	}
+
+	template<typename T>
+	struct ReadMembers
+	{
+		template<typename In>
+		static bool Read(In& in, T& value)
+		{
+			size_t index = 0;
+			auto field = [&](const auto& member)
+			{
+				if (!ReadField(in, value, member))
+					return false;
+				++index;
+				return true;
+			};
+			if (std::apply([&field](const auto&... members){return (field(members) && ...);}, Trait<T>::members))
+				return true;
+			return FailedWithin(MemberName<T>(index));
+		}
+
+		template<typename In>
+		static std::variant<T, Error> Read(In& in)
+		{
+			T value = Construct<T>(in);
+			if (!Read(in, value))
+				return std::move(LastError());
+			return value;
+		}
+	};
+
+	template<typename T>
+	struct ReadBitwise
+	{
+		template<typename In>
+		static bool Read(In& in, T& value)
+		{
+			if (!in.Read(std::addressof(value), sizeof(value)))
+				return Failed(in, ErrorKind::Truncated);
+			return true;
+		}
+
+		template<typename In>
+		static std::variant<T, Error> Read(In& in)
+		{
+			T value;
+			if (!Read(in, value))
+				return std::move(LastError());
+			return value;
+		}
+	};
+
+	template<typename T, typename In>
+	bool ReadScalars(In& in, T* data, size_t count)
+	{
+		if (!in.Read(data, count * sizeof(T)))
+			return false;
+		if constexpr (NeedsSwap<T, In>)
+			ByteSwapRange(data, count);
+		return true;
+	}
+
+	template<typename T, typename In> requires DefinedReadTrait<T, In>
+	std::variant<T, Error> Read(In& in)
+	{
+		return Trait<T>::Read(in);
+	}
+
+	// traits that only return a variant are bridged, ReadMembers and ReadBitwise read in place
+	template<typename T, typename In> requires DefinedReadTrait<T, In>
+	bool Read(In& in, T& value)
+	{
+		if constexpr (requires { Trait<T>::Read(in, value); })
+			return Trait<T>::Read(in, value);
+		else
+		{
+			auto temp = Trait<T>::Read(in);
+			if (std::holds_alternative<Error>(temp))
+				return Failed(std::move(std::get<Error>(temp)));
+			value = std::move(std::get<T>(temp));
+			return true;
+		}
+	}
+
+	// everything without a trait goes through the bool overloads below
+	template<typename T, typename In>
+	std::variant<T, Error> Read(In& in)
+	{
+		T value = Construct<T>(in);
+		if (!Read(in, value))
+			return std::move(LastError());
+		return value;
+	}
+
+	template<POD T, typename In>
+	bool Read(In& in, T& value)
+	{
+		if constexpr (Same<T, bool> && BitIn<In>)
+		{
+			uint64_t bit;
+			if (!in.ReadBits(bit, 1))
+				return Failed(in, ErrorKind::Truncated);
+			value = bit != 0;
+			return true;
+		}
+		else if constexpr (Array<T>)
+		{
+			if (!ReadScalars(in, value.data(), value.size()))
+				return Failed(in, ErrorKind::Truncated);
+			return true;
+		}
+		else
+		{
+			if (!ReadScalars(in, std::addressof(value), 1))
+				return Failed(in, ErrorKind::Truncated);
+			return true;
+		}
+	}
+
+	template<Optional T, typename In>
+	bool Read(In& in, T& value)
+	{
+		bool hasValue = false;
+		if (!Read(in, hasValue))
+			return false;
+		if (!hasValue)
+		{
+			value.reset();
+			return true;
+		}
+		value.emplace(Construct<typename T::value_type>(in));
+		return Read(in, *value);
+	}
+
+	template<typename T, typename In>
+		requires (Vector<T>&& POD<typename T::value_type>) || String<T>
+	bool Read(In& in, T& value)
+	{
+		if constexpr (InternIn<In> && String<T> && Same<typename T::value_type, char>)
+		{
+			std::string_view interned;
+			if (!in.ReadInterned(interned))
+				return Failed(in, ErrorKind::Invalid);
+			value.assign(interned.data(), interned.size());
+			return true;
+		}
+		size_t size = 0;
+		if (!Read(in, size))
+			return false;
+
+		value.resize(size);
+		if (!ReadScalars(in, value.data(), value.size()))
+			return Failed(in, ErrorKind::Truncated);
+		return true;
+	}
+
+	// views the characters kept by an interning reader, repeated strings share them
+	template<typename T, typename In> requires (StringView<T> && Same<typename T::value_type, char>)
+	bool Read(In& in, T& value)
+	{
+		static_assert(InternIn<In>, "string views can only be read from a stream that owns the characters, such as InterningReader");
+		if (!in.ReadInterned(value))
+			return Failed(in, ErrorKind::Invalid);
+		return true;
+	}
+
+	inline std::string IndexSegment(size_t index)
+	{
+		std::string segment = std::to_string(index);
+		segment.insert(segment.begin(), '[');
+		segment.push_back(']');
+		return segment;
+	}
+
+	inline Error ElementError(Error& error, size_t index)
+	{
+		error.Within(IndexSegment(index));
+		return std::move(error);
+	}
+
+	template<typename T, typename In> requires (Vector<T> && !POD<typename T::value_type>)
+	bool Read(In& in, T& value)
+	{
+		size_t size = 0;
+		if (!Read(in, size))
+			return false;
+
+		value.clear();
+		for (size_t i = 0;i < size;++i)
+		{
+			if (!Read(in, value.emplace_back(Construct<typename T::value_type>(in))))
+				return FailedWithin(IndexSegment(i));
+		}
+		return true;
+	}
+
+	template<typename T, typename In> requires (Array<T> && !POD<typename T::value_type>)
+	bool Read(In& in, T& value)
+	{
+		for (size_t i = 0;i < value.size();++i)
+		{
+			if (!Read(in, value[i]))
+				return FailedWithin(IndexSegment(i));
+		}
+		return true;
+	}
+
+	// member annotation for Trait<T>::members, packs an integer into the given bit width on BitWriter/BitReader
+	// and falls back to the full width elsewhere, signed values are sign extended on read
+	template<size_t bits, typename Member>
+	struct BitsMember
+	{
+		using Value = typename MemberPointerTrait<Member>::Type;
+		using Integer = typename std::conditional_t<std::is_enum_v<Value>, std::underlying_type<Value>, std::type_identity<Value>>::type;
+		static_assert(std::is_integral_v<Value> || std::is_enum_v<Value>, "Bits only applies to integer members");
+		static_assert(bits > 0 && bits <= sizeof(Value) * 8, "bit width exceeds the member size");
+
+		template<typename Out>
+		void Write(Out& out, const Value& value) const
+		{
+			if constexpr (BitOut<Out>)
+			{
+				out.WriteBits(static_cast<uint64_t>(value), bits);
+			}
+			else
+			{
+				using zs::Write;
+				Write(out, value);
+			}
+		}
+
+		template<typename In>
+		std::variant<Value, Error> Read(In& in) const
+		{
+			if constexpr (BitIn<In>)
+			{
+				uint64_t raw;
+				if (!in.ReadBits(raw, bits))
+					return Fail(in, ErrorKind::Truncated);
+				if constexpr (std::is_signed_v<Integer> && bits < 64)
+				{
+					if (raw & (uint64_t(1) << (bits - 1)))
+						raw |= ~uint64_t(0) << bits;
+				}
+				return static_cast<Value>(raw);
+			}
+			else
+			{
+				using zs::Read;
+				return Read<Value>(in);
+			}
+		}
+
+		Member member;
+	};
+
+	template<size_t bits, typename Member>
+	constexpr BitsMember<bits, Member> Bits(Member member)
+	{
+		return { member };
+	}
+
+
+	template<typename T>
+	constexpr size_t FloatCount()
+	{
+		if constexpr (Same<T, float>)
+			return 1;
+		else if constexpr (Array<T>)
+			return std::tuple_size_v<T> * FloatCount<typename T::value_type>();
+		else if constexpr (Reflected<T>)
+			return std::apply([](auto&&... args){return (FloatCount<FieldType<T, decltype(args)>>() + ... + 0);}, Trait<T>::members);
+		else
+			static_assert(Same<T, float>, "quantization applies to floats and arrays or Trait structs of floats");
+	}
+
+	template<typename T, typename Func>
+	void ForEachFloat(T& value, Func&& func)
+	{
+		using Value = std::remove_const_t<T>;
+		if constexpr (Same<Value, float>)
+			func(value);
+		else if constexpr (Array<Value>)
+			for (auto& v : value)
+				ForEachFloat(v, func);
+		else
+			ForEach(Trait<Value>::members, [&value, &func](auto member){ForEachFloat(Field(value, member), func);});
+	}
+
+	template<size_t bits, typename Out>
+	void WriteUnsigned(Out& out, uint64_t value)
+	{
+		if constexpr (BitOut<Out>)
+			out.WriteBits(value, bits);
+		else
+			Write(out, static_cast<UnsignedFor<bits>>(value));
+	}
+
+	template<size_t bits, typename In>
+	bool ReadUnsigned(In& in, uint64_t& value)
+	{
+		if constexpr (BitIn<In>)
+			return in.ReadBits(value, bits);
+		else
+		{
+			UnsignedFor<bits> temp;
+			if (!Read(in, temp))
+				return false;
+			value = temp;
+			return true;
+		}
+	}
+
+	// LEB128, 7 bits per byte with the high bit set on all but the last byte
+	inline size_t EncodeVarint(uint64_t value, char* dest)
+	{
+		size_t size = 0;
+		while (value >= 0x80)
+		{
+			dest[size++] = static_cast<char>(value | 0x80);
+			value >>= 7;
+		}
+		dest[size++] = static_cast<char>(value);
+		return size;
+	}
+
+	// returns the bytes used, 0 when data ends before the varint does or it runs past 10 bytes
+	inline size_t DecodeVarint(std::string_view data, uint64_t& value)
+	{
+		value = 0;
+		for (size_t i = 0; i < data.size() && i < 10; ++i)
+		{
+			auto byte = static_cast<uint8_t>(data[i]);
+			value |= uint64_t(byte & 0x7f) << (7 * i);
+			if (byte < 0x80)
+				return i + 1;
+		}
+		return 0;
+	}
+
+	template<typename Out>
+	void WriteVarint(Out& out, uint64_t value)
+	{
+		char bytes[10];
+		out.Write(bytes, EncodeVarint(value, bytes));
+	}
+
+	template<typename In>
+	bool ReadVarint(In& in, uint64_t& value)
+	{
+		value = 0;
+		for (size_t shift = 0; shift < 70; shift += 7)
+		{
+			uint8_t byte;
+			if (!in.Read(&byte, 1))
+				return false;
+			value |= uint64_t(byte & 0x7f) << shift;
+			if (byte < 0x80)
+				return true;
+		}
+		return false;
+	}
+
+	// values outside [min, max] are clamped, NaN maps to min
+	inline uint32_t QuantizeFloat(float value, float min, float max, size_t bits)
+	{
+		float top = float((uint32_t(1) << bits) - 1);
+		float scaled = (value - min) * (top / (max - min));
+		scaled = scaled > 0.f ? scaled : 0.f;
+		scaled = scaled < top ? scaled : top;
+		return uint32_t(scaled + 0.5f);
+	}
+
+	inline float DequantizeFloat(uint32_t value, float min, float max, size_t bits)
+	{
+		float top = float((uint32_t(1) << bits) - 1);
+		return float(value) * ((max - min) / top) + min;
+	}
+
+	// bulk versions for up to 16 bits, bit identical to the scalar ones
+	inline void QuantizeFloats(const float* source, uint16_t* dest, size_t count, float min, float max, size_t bits)
+	{
+		size_t i = 0;
+#if defined(__SSE2__)
+		float top = float((uint32_t(1) << bits) - 1);
+		__m128 vmin = _mm_set1_ps(min);
+		__m128 vscale = _mm_set1_ps(top / (max - min));
+		__m128 vtop = _mm_set1_ps(top);
+		__m128 vhalf = _mm_set1_ps(0.5f);
+		__m128 vzero = _mm_setzero_ps();
+		// _mm_packus_epi32 needs SSE4.1, so pack signed around a 32768 bias instead
+		__m128i bias = _mm_set1_epi32(32768);
+		__m128i flip = _mm_set1_epi16(int16_t(0x8000));
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128 a = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(source + i), vmin), vscale);
+			__m128 b = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(source + i + 4), vmin), vscale);
+			a = _mm_min_ps(_mm_max_ps(a, vzero), vtop);
+			b = _mm_min_ps(_mm_max_ps(b, vzero), vtop);
+			__m128i ia = _mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(a, vhalf)), bias);
+			__m128i ib = _mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(b, vhalf)), bias);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_xor_si128(_mm_packs_epi32(ia, ib), flip));
+		}
+#endif
+		for (; i < count; ++i)
+			dest[i] = uint16_t(QuantizeFloat(source[i], min, max, bits));
+	}
+
+	inline void DequantizeFloats(const uint16_t* source, float* dest, size_t count, float min, float max, size_t bits)
+	{
+		size_t i = 0;
+#if defined(__SSE2__)
+		float top = float((uint32_t(1) << bits) - 1);
+		__m128 vmin = _mm_set1_ps(min);
+		__m128 vstep = _mm_set1_ps((max - min) / top);
+		__m128i zero = _mm_setzero_si128();
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i q = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+			__m128 a = _mm_cvtepi32_ps(_mm_unpacklo_epi16(q, zero));
+			__m128 b = _mm_cvtepi32_ps(_mm_unpackhi_epi16(q, zero));
+			_mm_storeu_ps(dest + i, _mm_add_ps(_mm_mul_ps(a, vstep), vmin));
+			_mm_storeu_ps(dest + i + 4, _mm_add_ps(_mm_mul_ps(b, vstep), vmin));
+		}
+#endif
+		for (; i < count; ++i)
+			dest[i] = DequantizeFloat(source[i], min, max, bits);
+	}
+
+	// member annotation for Trait<T>::members, stores every float of the member in bits within [min, max]
+	// the member may be a float, an array or Trait struct of floats, or a vector of those which takes the bulk path
+	template<size_t bits, typename Member>
+	struct QuantizedMember
+	{
+		using Value = typename MemberPointerTrait<Member>::Type;
+		static_assert(bits > 0 && bits <= 24, "quantized floats support 1 to 24 bits");
+
+		template<typename Out>
+		void Write(Out& out, const Value& value) const
+		{
+			if constexpr (Vector<Value>)
+				WriteBulk(out, value);
+			else
+				ForEachFloat(value, [this, &out](float f){WriteUnsigned<bits>(out, QuantizeFloat(f, min, max, bits));});
+		}
+
+		template<typename In>
+		std::variant<Value, Error> Read(In& in) const
+		{
+			if constexpr (Vector<Value>)
+				return ReadBulk(in);
+			else
+			{
+				Value value{};
+				bool failed = false;
+				ForEachFloat(value, [this, &in, &failed](float& f)
+				{
+					uint64_t q;
+					if (failed || !ReadUnsigned<bits>(in, q))
+					{
+						failed = true;
+						return;
+					}
+					f = DequantizeFloat(uint32_t(q), min, max, bits);
+				});
+				if (failed)
+					return Fail(in, ErrorKind::Truncated);
+				return value;
+			}
+		}
+
+		static constexpr size_t chunk = 256;
+
+		template<typename Out>
+		void WriteBulk(Out& out, const Value& value) const
+		{
+			using Element = typename Value::value_type;
+			static_assert(bits <= 16, "bulk quantization supports up to 16 bits");
+			static_assert(std::is_trivially_copyable_v<Element> && sizeof(Element) == FloatCount<Element>() * sizeof(float),
+				"bulk quantization needs elements made of tightly packed floats");
+
+			using zs::Write;
+			Write(out, value.size());
+			auto bytes = reinterpret_cast<const char*>(value.data());
+			size_t count = value.size() * FloatCount<Element>();
+			float floats[chunk];
+			uint16_t q[chunk];
+			for (size_t i = 0; i < count; i += chunk)
+			{
+				size_t n = std::min(chunk, count - i);
+				std::memcpy(floats, bytes + i * sizeof(float), n * sizeof(float));
+				QuantizeFloats(floats, q, n, min, max, bits);
+				if constexpr (BitOut<Out> || bits <= 8)
+					for (size_t j = 0; j < n; ++j)
+						WriteUnsigned<bits>(out, q[j]);
+				else
+					WriteScalars(out, q, n);
+			}
+		}
+
+		template<typename In>
+		std::variant<Value, Error> ReadBulk(In& in) const
+		{
+			using Element = typename Value::value_type;
+			using zs::Read;
+			ZS_READ(size_t, in, size);
+
+			Value value = Construct<Value>(in);
+			value.resize(size);
+			auto bytes = reinterpret_cast<char*>(value.data());
+			size_t count = value.size() * FloatCount<Element>();
+			float floats[chunk];
+			uint16_t q[chunk];
+			for (size_t i = 0; i < count; i += chunk)
+			{
+				size_t n = std::min(chunk, count - i);
+				if constexpr (BitIn<In> || bits <= 8)
+				{
+					for (size_t j = 0; j < n; ++j)
+					{
+						uint64_t temp;
+						if (!ReadUnsigned<bits>(in, temp))
+							return Fail(in, ErrorKind::Truncated);
+						q[j] = uint16_t(temp);
+					}
+				}
+				else if (!ReadScalars(in, q, n))
+					return Fail(in, ErrorKind::Truncated);
+				DequantizeFloats(q, floats, n, min, max, bits);
+				std::memcpy(bytes + i * sizeof(float), floats, n * sizeof(float));
+			}
+			return value;
+		}
+
+		Member member;
+		float min;
+		float max;
+	};
+
+	template<size_t bits, typename Member>
+	constexpr QuantizedMember<bits, Member> Quantized(Member member, float min, float max)
+	{
+		return { member, min, max };
+	}
+
+	inline uint16_t FloatToHalf(float value)
+	{
+		// round to nearest even, after https://gist.github.com/rygorous/2156668
+		uint32_t f = std::bit_cast<uint32_t>(value);
+		uint32_t sign = f & 0x80000000u;
+		f ^= sign;
+		uint16_t half;
+		if (f >= (127u + 16) << 23)
+			half = f > 0x7f800000u ? 0x7e00 : 0x7c00;
+		else if (f < 113u << 23)
+		{
+			constexpr uint32_t magic = ((127u - 15) + (23 - 10) + 1) << 23;
+			half = uint16_t(std::bit_cast<uint32_t>(std::bit_cast<float>(f) + std::bit_cast<float>(magic)) - magic);
+		}
+		else
+		{
+			uint32_t odd = (f >> 13) & 1;
+			f += ((15u - 127) << 23) + 0xfff + odd;
+			half = uint16_t(f >> 13);
+		}
+		return uint16_t(half | (sign >> 16));
+	}
+
+	inline float HalfToFloat(uint16_t half)
+	{
+		constexpr uint32_t shiftedExp = 0x7c00u << 13;
+		uint32_t f = uint32_t(half & 0x7fff) << 13;
+		uint32_t exp = f & shiftedExp;
+		f += (127u - 15) << 23;
+		if (exp == shiftedExp)
+			f += (128u - 16) << 23;
+		else if (exp == 0)
+		{
+			f += 1u << 23;
+			f = std::bit_cast<uint32_t>(std::bit_cast<float>(f) - std::bit_cast<float>(113u << 23));
+		}
+		return std::bit_cast<float>(f | (uint32_t(half & 0x8000) << 16));
+	}
+
+	// member annotation for Trait<T>::members, stores every float of the member as an IEEE half
+	template<typename Member>
+	struct HalfMember
+	{
+		using Value = typename MemberPointerTrait<Member>::Type;
+
+		template<typename Out>
+		void Write(Out& out, const Value& value) const
+		{
+			ForEachFloat(value, [&out](float f){WriteUnsigned<16>(out, FloatToHalf(f));});
+		}
+
+		template<typename In>
+		std::variant<Value, Error> Read(In& in) const
+		{
+			Value value{};
+			bool failed = false;
+			ForEachFloat(value, [&in, &failed](float& f)
+			{
+				uint64_t half;
+				if (failed || !ReadUnsigned<16>(in, half))
+				{
+					failed = true;
+					return;
+				}
+				f = HalfToFloat(uint16_t(half));
+			});
+			if (failed)
+				return Fail(in, ErrorKind::Truncated);
+			return value;
+		}
+
+		Member member;
+	};
+
+	template<typename Member>
+	constexpr HalfMember<Member> Half(Member member)
+	{
+		return { member };
+	}
+
+	// member annotation for Trait<T>::members holding a unit quaternion of 4 floats, writes the index of the largest
+	// component and the other three quantized in bits each, packed into a single 2 + 3 * bits wide integer
+	template<size_t bits, typename Member>
+	struct SmallestThreeMember
+	{
+		using Value = typename MemberPointerTrait<Member>::Type;
+		static_assert(FloatCount<Value>() == 4, "smallest three applies to quaternions of 4 floats");
+		static_assert(bits > 0 && bits <= 20, "smallest three supports 1 to 20 bits per component");
+
+		static constexpr float range = 0.70710678f;
+
+		template<typename Out>
+		void Write(Out& out, const Value& value) const
+		{
+			float q[4];
+			size_t index = 0;
+			ForEachFloat(value, [&q, &index](float f){q[index++] = f;});
+
+			size_t largest = 0;
+			for (size_t i = 1; i < 4; ++i)
+				if (std::fabs(q[i]) > std::fabs(q[largest]))
+					largest = i;
+			float sign = q[largest] < 0.f ? -1.f : 1.f;
+
+			uint64_t packed = largest;
+			for (size_t i = 0; i < 4; ++i)
+				if (i != largest)
+					packed = (packed << bits) | QuantizeFloat(q[i] * sign, -range, range, bits);
+			WriteUnsigned<2 + 3 * bits>(out, packed);
+		}
+
+		template<typename In>
+		std::variant<Value, Error> Read(In& in) const
+		{
+			uint64_t packed;
+			if (!ReadUnsigned<2 + 3 * bits>(in, packed))
+				return Fail(in, ErrorKind::Truncated);
+
+			float q[4];
+			size_t largest = packed >> (3 * bits);
+			float sum = 0.f;
+			for (size_t i = 4; i-- > 0;)
+			{
+				if (i == largest)
+					continue;
+				q[i] = DequantizeFloat(uint32_t(packed & ((uint64_t(1) << bits) - 1)), -range, range, bits);
+				packed >>= bits;
+				sum += q[i] * q[i];
+			}
+			q[largest] = std::sqrt(std::max(0.f, 1.f - sum));
+
+			Value value{};
+			size_t index = 0;
+			ForEachFloat(value, [&q, &index](float& f){f = q[index++];});
+			return value;
+		}
+
+		Member member;
+	};
+
+	template<size_t bits, typename Member>
+	constexpr SmallestThreeMember<bits, Member> SmallestThree(Member member)
+	{
+		return { member };
+	}
+
+	template<typename T>
+	bool DeltaEqual(const T& lhs, const T& rhs)
+	{
+		if constexpr (Reflected<T>)
+			return std::apply([&lhs, &rhs](auto&&... args){return (DeltaEqual(Field(lhs, args), Field(rhs, args)) && ...);}, Trait<T>::members);
+		else if constexpr (std::is_array_v<T>)
+		{
+			for (size_t i = 0; i < std::extent_v<T>; ++i)
+				if (!DeltaEqual(lhs[i], rhs[i]))
+					return false;
+			return true;
+		}
+		else
+			return lhs == rhs;
+	}
+
+	// a bitmask of changed members followed by the changed members in declaration order,
+	// members that are Trait structs themselves are delta encoded against their baseline, annotated members keep their encoding
+	template<Reflected T, typename Out>
+	void WriteDelta(Out& out, const T& baseline, const T& current)
+	{
+		static_assert(MemberCount<T> <= 64, "delta encoding supports up to 64 members");
+		using Mask = UnsignedFor<MemberCount<T>>;
+
+		Mask mask = 0;
+		size_t index = 0;
+		ForEach(Trait<T>::members, [&](auto member)
+		{
+			if (!DeltaEqual(Field(baseline, member), Field(current, member)))
+				mask |= Mask(1) << index;
+			++index;
+		});
+		Write(out, mask);
+
+		index = 0;
+		ForEach(Trait<T>::members, [&](auto member)
+		{
+			if (!(mask & (Mask(1) << index++)))
+				return;
+			if constexpr (MemberPointer<decltype(member)> && Reflected<FieldType<T, decltype(member)>>)
+				WriteDelta(out, Field(baseline, member), Field(current, member));
+			else
+				WriteField(out, current, member);
+		});
+	}
+
+	template<Reflected T, typename In>
+	std::variant<T, Error> ReadDelta(In& in, const T& baseline)
+	{
+		static_assert(MemberCount<T> <= 64, "delta encoding supports up to 64 members");
+		using Mask = UnsignedFor<MemberCount<T>>;
+
+		ZS_READ(Mask, in, mask);
+
+		T value = baseline;
+		std::optional<Error> error;
+		size_t index = 0;
+		ForEach(Trait<T>::members, [&](auto member)
+		{
+			if (error || !(mask & (Mask(1) << index++)))
+				return;
+			using Member = FieldType<T, decltype(member)>;
+			if constexpr (MemberPointer<decltype(member)> && Reflected<Member>)
+			{
+				auto temp = ReadDelta(in, Field(baseline, member));
+				if (std::holds_alternative<Error>(temp))
+					error = std::move(std::get<Error>(temp));
+				else
+					Field(value, member) = std::move(std::get<Member>(temp));
+			}
+			else if (!ReadField(in, value, member))
+				error = std::move(LastError());
+			if (error)
+				error->Within(MemberName<T>(index - 1));
+		});
+		if (error)
+			return std::move(*error);
+		return value;
+	}
+
+	template<typename T>
+	std::string TypeName()
+	{
+		if constexpr (requires { Trait<T>::name; })
+			return Trait<T>::name;
+		else
+			return typeid(T).name();
+	}
+
+	// Trait<T>::names optionally lists member names in the order of Trait<T>::members
+	template<typename T>
+	std::string MemberName(size_t index)
+	{
+		if constexpr (requires { Trait<T>::names; })
+			return Trait<T>::names[index];
+		else
+			return std::to_string(index);
+	}
+
+	struct FieldStats
+	{
+		uint64_t bytes = 0;
+		uint64_t count = 0;
+	};
+
+	struct FieldProfile
+	{
+		void Add(const std::string& path, uint64_t bytes)
+		{
+			auto& stats = fields[path];
+			stats.bytes += bytes;
+			++stats.count;
+		}
+
+		std::vector<std::pair<std::string, FieldStats>> Sorted() const
+		{
+			std::vector<std::pair<std::string, FieldStats>> sorted(fields.begin(), fields.end());
+			std::sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs)
+			{
+				return lhs.second.bytes != rhs.second.bytes ? lhs.second.bytes > rhs.second.bytes : lhs.first < rhs.first;
+			});
+			return sorted;
+		}
+
+		void Report(std::ostream& os) const
+		{
+			uint64_t total = 0;
+			for (const auto& [path, stats] : fields)
+				if (path.find('.') == std::string::npos)
+					total += stats.bytes;
+			for (const auto& [path, stats] : Sorted())
+			{
+				os << path << '\t' << stats.bytes << " bytes\t"
+					<< double(stats.bytes) / double(stats.count) << " per message\t"
+					<< (total ? 100.0 * double(stats.bytes) / double(total) : 0.0) << "%\n";
+			}
+		}
+
+		std::unordered_map<std::string, FieldStats> fields;
+	};
+
+	template<typename T, typename Out>
+	concept WrittenMemberwise = Reflected<T> && (std::is_base_of_v<WriteMembers<T>, Trait<T>> || !DefinedWriteTrait<T, Out>);
+
+	// forwards everything to out, Profile attributes the bytes of each member path such as State.pos.x to profile,
+	// parents accumulate their children, members with an annotation or a custom Trait Write are counted as a whole
+	template<typename Out>
+	struct ProfilingWriter
+	{
+		static constexpr std::endian endian = WireEndian<Out>;
+
+		ProfilingWriter(Out& out, FieldProfile& profile):out_(out), profile_(profile){}
+
+		void Write(const void* source, size_t bytes)
+		{
+			bits_ += bytes * 8;
+			out_.Write(source, bytes);
+		}
+
+		void WriteBits(uint64_t value, size_t bits) requires BitOut<Out>
+		{
+			bits_ += bits;
+			out_.WriteBits(value, bits);
+		}
+
+		void WriteRef(const void* source, size_t bytes) requires RefOut<Out>
+		{
+			bits_ += bytes * 8;
+			out_.WriteRef(source, bytes);
+		}
+
+		// the encoding is the interning stream's, the profile is charged the characters handed to it
+		void WriteInterned(std::string_view value) requires InternOut<Out>
+		{
+			bits_ += value.size() * 8;
+			out_.WriteInterned(value);
+		}
+
+		template<typename T>
+		void Profile(const T& value)
+		{
+			Profile(value, TypeName<T>());
+		}
+
+		template<typename T>
+		void Profile(const T& value, const std::string& path)
+		{
+			uint64_t begin = bits_;
+			if constexpr (WrittenMemberwise<T, ProfilingWriter>)
+			{
+				size_t index = 0;
+				ForEach(Trait<T>::members, [this, &value, &path, &index](auto member)
+				{
+					std::string child = path + '.' + MemberName<T>(index++);
+					if constexpr (MemberPointer<decltype(member)>)
+						Profile(value.*member, child);
+					else
+					{
+						uint64_t fieldBegin = bits_;
+						WriteField(*this, value, member);
+						profile_.Add(child, (bits_ - fieldBegin + 7) / 8);
+					}
+				});
+			}
+			else
+			{
+				using zs::Write;
+				Write(*this, value);
+			}
+			profile_.Add(path, (bits_ - begin + 7) / 8);
+		}
+
+		Out& out_;
+		FieldProfile& profile_;
+		uint64_t bits_ = 0;
+	};
+
+	struct IoStats
+	{
+		uint64_t calls = 0;
+		uint64_t allocations = 0;
+		uint64_t allocatedBytes = 0;
+		uint64_t bytes = 0;
+	};
+
+	struct TypeStats
+	{
+		const char* type;
+		IoStats write;
+		IoStats read;
+	};
+
+#if defined(ZS_INSTRUMENT)
+	// allocations are attributed through RecordAllocation, called from the application's operator new or ZS_COUNTING_NEW
+	struct Instrumentation
+	{
+		struct Counters
+		{
+			std::atomic<uint64_t> calls{ 0 };
+			std::atomic<uint64_t> allocations{ 0 };
+			std::atomic<uint64_t> allocatedBytes{ 0 };
+			std::atomic<uint64_t> bytes{ 0 };
+
+			void Add(uint64_t count, uint64_t allocationCount, uint64_t allocationBytes)
+			{
+				calls.fetch_add(1, std::memory_order_relaxed);
+				bytes.fetch_add(count, std::memory_order_relaxed);
+				allocations.fetch_add(allocationCount, std::memory_order_relaxed);
+				allocatedBytes.fetch_add(allocationBytes, std::memory_order_relaxed);
+			}
+
+			IoStats Load() const
+			{
+				return { calls.load(std::memory_order_relaxed), allocations.load(std::memory_order_relaxed),
+					allocatedBytes.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed) };
+			}
+
+			void Reset()
+			{
+				calls = 0;
+				allocations = 0;
+				allocatedBytes = 0;
+				bytes = 0;
+			}
+		};
+
+		struct Entry
+		{
+			Entry(const char* name):type(name){}
+
+			const char* type;
+			Counters write;
+			Counters read;
+		};
+
+		template<typename T>
+		static Entry& For()
+		{
+			static Entry& entry = []() -> Entry&
+			{
+				std::lock_guard lock(mutex);
+				return entries.emplace_back(typeid(T).name());
+			}();
+			return entry;
+		}
+
+		static void RecordAllocation(size_t bytes)
+		{
+			++allocations;
+			allocatedBytes += bytes;
+		}
+
+		// live and peak heap bytes as the allocator sees them, fed by ZS_COUNTING_NEW
+		static void RecordHeld(int64_t bytes)
+		{
+			liveBytes += bytes;
+			peakBytes = std::max(peakBytes, liveBytes);
+		}
+
+		static std::vector<TypeStats> Snapshot()
+		{
+			std::lock_guard lock(mutex);
+			std::vector<TypeStats> stats;
+			for (const auto& entry : entries)
+				stats.push_back({ entry.type, entry.write.Load(), entry.read.Load() });
+			return stats;
+		}
+
+		static void Reset()
+		{
+			std::lock_guard lock(mutex);
+			for (auto& entry : entries)
+			{
+				entry.write.Reset();
+				entry.read.Reset();
+			}
+		}
+
+		static inline thread_local uint64_t allocations = 0;
+		static inline thread_local uint64_t allocatedBytes = 0;
+		static inline thread_local int64_t liveBytes = 0;
+		static inline thread_local int64_t peakBytes = 0;
+		static inline std::mutex mutex;
+		static inline std::list<Entry> entries;
+	};
+
+	// the allocation behind ZS_COUNTING_NEW, alignment 0 means the default one
+	inline void* CountedAllocate(size_t size, size_t alignment) noexcept
+	{
+		Instrumentation::RecordAllocation(size);
+		size = size ? size : 1;
+		void* p = alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__ ? std::malloc(size) :
+			std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+		if (p)
+			Instrumentation::RecordHeld(int64_t(malloc_usable_size(p)));
+		return p;
+	}
+
+	inline void CountedFree(void* p) noexcept
+	{
+		if (p)
+			Instrumentation::RecordHeld(-int64_t(malloc_usable_size(p)));
+		std::free(p);
+	}
+
+	inline void* CountedNew(size_t size, size_t alignment)
+	{
+		if (void* p = CountedAllocate(size, alignment))
+			return p;
+		throw std::bad_alloc();
+	}
+
+	template<typename Out>
+	struct CountingWriter
+	{
+		static constexpr std::endian endian = WireEndian<Out>;
+
+		CountingWriter(Out& out):out_(out){}
+
+		void Write(const void* source, size_t bytes)
+		{
+			bits_ += bytes * 8;
+			out_.Write(source, bytes);
+		}
+
+		void WriteBits(uint64_t value, size_t bits) requires BitOut<Out>
+		{
+			bits_ += bits;
+			out_.WriteBits(value, bits);
+		}
+
+		void WriteRef(const void* source, size_t bytes) requires RefOut<Out>
+		{
+			bits_ += bytes * 8;
+			out_.WriteRef(source, bytes);
+		}
+
+		// interned strings count their characters, how many of them reach the wire is up to the interning stream
+		void WriteInterned(std::string_view value) requires InternOut<Out>
+		{
+			bits_ += value.size() * 8;
+			out_.WriteInterned(value);
+		}
+
+		Out& out_;
+		uint64_t bits_ = 0;
+	};
+
+	template<typename In>
+	struct CountingReader
+	{
+		static constexpr std::endian endian = WireEndian<In>;
+
+		CountingReader(In& in):in_(in)
+		{
+			if constexpr (ResourceIn<In>)
+				resource = in.resource;
+		}
+
+		bool Read(void* dest, size_t bytes)
+		{
+			bits_ += bytes * 8;
+			return in_.Read(dest, bytes);
+		}
+
+		bool ReadBits(uint64_t& value, size_t bits) requires BitIn<In>
+		{
+			bits_ += bits;
+			return in_.ReadBits(value, bits);
+		}
+
+		bool ReadInterned(std::string_view& value) requires InternIn<In>
+		{
+			if (!in_.ReadInterned(value))
+				return false;
+			bits_ += value.size() * 8;
+			return true;
+		}
+
+		size_t Position() requires Positioned<In>
+		{
+			return in_.Position();
+		}
+
+		In& in_;
+		uint64_t bits_ = 0;
+		// the wrapped reader's memory resource, so allocator aware values keep allocating from it
+		[[no_unique_address]] std::conditional_t<ResourceIn<In>, std::pmr::memory_resource*, std::monostate> resource{};
+	};
+
+#else
+	struct Instrumentation
+	{
+		static void RecordAllocation(size_t) {}
+		static std::vector<TypeStats> Snapshot() { return {}; }
+		static void Reset() {}
+	};
+#endif
+
+	// Write and Read that record calls, bytes and allocations per type when ZS_INSTRUMENT is defined
+	template<typename T, typename Out>
+	void InstrumentedWrite(Out& out, const T& value)
+	{
+#if defined(ZS_INSTRUMENT)
+		auto allocations = Instrumentation::allocations;
+		auto allocatedBytes = Instrumentation::allocatedBytes;
+		CountingWriter<Out> counted(out);
+		Write(counted, value);
+		Instrumentation::For<T>().write.Add((counted.bits_ + 7) / 8,
+			Instrumentation::allocations - allocations, Instrumentation::allocatedBytes - allocatedBytes);
+#else
+		Write(out, value);
+#endif
+	}
+
+	template<typename T, typename In>
+	std::variant<T, Error> InstrumentedRead(In& in)
+	{
+#if defined(ZS_INSTRUMENT)
+		auto allocations = Instrumentation::allocations;
+		auto allocatedBytes = Instrumentation::allocatedBytes;
+		CountingReader<In> counted(in);
+		auto result = Read<T>(counted);
+		Instrumentation::For<T>().read.Add((counted.bits_ + 7) / 8,
+			Instrumentation::allocations - allocations, Instrumentation::allocatedBytes - allocatedBytes);
+		return result;
+#else
+		return Read<T>(in);
+#endif
 	}
 }
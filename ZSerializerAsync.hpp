@@ -0,0 +1,339 @@
+#pragma once
+#include "ZSerializerResumable.hpp"
+#include <cerrno>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace zs
+{
+	// a lazily started coroutine, awaiting it runs it and resumes the awaiter once it returns
+	template<typename T>
+	struct Task
+	{
+		struct promise_type
+		{
+			Task get_return_object()
+			{
+				return Task{ std::coroutine_handle<promise_type>::from_promise(*this) };
+			}
+
+			std::suspend_always initial_suspend() noexcept
+			{
+				return {};
+			}
+
+			auto final_suspend() noexcept
+			{
+				struct Continue
+				{
+					bool await_ready() noexcept
+					{
+						return false;
+					}
+
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+					{
+						auto continuation = handle.promise().continuation;
+						return continuation ? continuation : std::noop_coroutine();
+					}
+
+					void await_resume() noexcept{}
+				};
+				return Continue{};
+			}
+
+			void return_value(T result)
+			{
+				value.emplace(std::move(result));
+			}
+
+			void unhandled_exception()
+			{
+				error = std::current_exception();
+			}
+
+			std::optional<T> value;
+			std::exception_ptr error;
+			std::coroutine_handle<> continuation;
+		};
+
+		explicit Task(std::coroutine_handle<promise_type> handle)
+			:handle_(handle){}
+
+		Task(Task&& other) noexcept
+			:handle_(std::exchange(other.handle_, nullptr)){}
+
+		Task& operator=(Task&&) = delete;
+
+		~Task()
+		{
+			if (handle_)
+				handle_.destroy();
+		}
+
+		// runs a top level task up to its first suspension, an event loop takes it from there
+		void Start()
+		{
+			handle_.resume();
+		}
+
+		bool Done() const
+		{
+			return handle_.done();
+		}
+
+		T Result()
+		{
+			auto& promise = handle_.promise();
+			if (promise.error)
+				std::rethrow_exception(promise.error);
+			return std::move(*promise.value);
+		}
+
+		bool await_ready() const
+		{
+			return false;
+		}
+
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation)
+		{
+			handle_.promise().continuation = continuation;
+			return handle_;
+		}
+
+		T await_resume()
+		{
+			return Result();
+		}
+
+		std::coroutine_handle<promise_type> handle_;
+	};
+
+	// Fill yields the buffered input, reading more only when nothing is buffered, and an empty view at end of stream
+	// Consume drops bytes a decoder has used, the rest stay buffered for the next message
+	template<typename Stream>
+	concept AsyncStream = requires(Stream stream, size_t bytes, std::string_view data)
+	{
+		{ stream.Fill() } -> std::same_as<Task<std::string_view>>;
+		stream.Consume(bytes);
+		{ stream.Write(data) } -> std::same_as<Task<bool>>;
+	};
+
+	// single threaded, level triggered, every fd is watched only while a coroutine waits on it
+	struct EventLoop
+	{
+		struct Watch
+		{
+			int fd;
+			std::coroutine_handle<> reader = nullptr;
+			std::coroutine_handle<> writer = nullptr;
+			bool added = false;
+		};
+
+		struct Ready
+		{
+			bool await_ready() const
+			{
+				return false;
+			}
+
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				(write ? watch.writer : watch.reader) = handle;
+				++loop.waiting_;
+				loop.Update(watch);
+			}
+
+			void await_resume() const{}
+
+			EventLoop& loop;
+			Watch& watch;
+			bool write;
+		};
+
+		EventLoop()
+			:fd_(epoll_create1(EPOLL_CLOEXEC)){}
+
+		EventLoop(const EventLoop&) = delete;
+		EventLoop& operator=(const EventLoop&) = delete;
+
+		~EventLoop()
+		{
+			close(fd_);
+		}
+
+		Ready Readable(Watch& watch)
+		{
+			return Ready{ *this, watch, false };
+		}
+
+		Ready Writable(Watch& watch)
+		{
+			return Ready{ *this, watch, true };
+		}
+
+		// an fd nobody waits on is removed, epoll reports hang ups and errors even for an empty event mask
+		void Update(Watch& watch)
+		{
+			if (!watch.reader && !watch.writer)
+			{
+				if (watch.added)
+					epoll_ctl(fd_, EPOLL_CTL_DEL, watch.fd, nullptr);
+				watch.added = false;
+				return;
+			}
+			epoll_event event{};
+			event.events = (watch.reader ? uint32_t(EPOLLIN) : 0) | (watch.writer ? uint32_t(EPOLLOUT) : 0);
+			event.data.ptr = &watch;
+			epoll_ctl(fd_, watch.added ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, watch.fd, &event);
+			watch.added = true;
+		}
+
+		void Forget(Watch& watch)
+		{
+			waiting_ -= bool(watch.reader) + bool(watch.writer);
+			watch.reader = nullptr;
+			watch.writer = nullptr;
+			Update(watch);
+		}
+
+		// waits for readiness once and resumes every coroutine it unblocks, false when nothing is waiting
+		bool RunOnce(int timeoutMs = -1)
+		{
+			if (waiting_ == 0)
+				return false;
+			epoll_event events[64];
+			int count = epoll_wait(fd_, events, 64, timeoutMs);
+			for (int i = 0; i < count; ++i)
+			{
+				auto& watch = *static_cast<Watch*>(events[i].data.ptr);
+				bool failed = events[i].events & (EPOLLERR | EPOLLHUP);
+				auto reader = (events[i].events & EPOLLIN) || failed ? std::exchange(watch.reader, nullptr) : nullptr;
+				auto writer = (events[i].events & EPOLLOUT) || failed ? std::exchange(watch.writer, nullptr) : nullptr;
+				waiting_ -= bool(reader) + bool(writer);
+				Update(watch);
+				if (reader)
+					reader.resume();
+				if (writer)
+					writer.resume();
+			}
+			return true;
+		}
+
+		template<typename Done>
+		void RunUntil(Done done)
+		{
+			while (!done() && RunOnce()){}
+		}
+
+		int fd_;
+		size_t waiting_ = 0;
+	};
+
+	// a non blocking socket or pipe end driven by an EventLoop, the fd stays owned by the caller
+	struct EpollStream
+	{
+		EpollStream(EventLoop& loop, int fd, size_t bufferBytes = 64 * 1024)
+			:loop_(loop), watch_{ .fd = fd }, buffer_(bufferBytes, '\0')
+		{
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		}
+
+		EpollStream(const EpollStream&) = delete;
+		EpollStream& operator=(const EpollStream&) = delete;
+
+		~EpollStream()
+		{
+			loop_.Forget(watch_);
+		}
+
+		Task<std::string_view> Fill()
+		{
+			while (begin_ == end_)
+			{
+				ssize_t got = read(watch_.fd, buffer_.data(), buffer_.size());
+				if (got > 0)
+				{
+					begin_ = 0;
+					end_ = got;
+				}
+				else if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+					co_await loop_.Readable(watch_);
+				else if (got < 0 && errno == EINTR)
+					continue;
+				else
+					co_return std::string_view{};
+			}
+			co_return std::string_view(buffer_.data() + begin_, end_ - begin_);
+		}
+
+		void Consume(size_t bytes)
+		{
+			begin_ += bytes;
+		}
+
+		Task<bool> Write(std::string_view data)
+		{
+			while (!data.empty())
+			{
+				ssize_t put = write(watch_.fd, data.data(), data.size());
+				if (put >= 0)
+					data.remove_prefix(put);
+				else if (errno == EAGAIN || errno == EWOULDBLOCK)
+					co_await loop_.Writable(watch_);
+				else if (errno != EINTR)
+					co_return false;
+			}
+			co_return true;
+		}
+
+		EventLoop& loop_;
+		EventLoop::Watch watch_;
+		std::string buffer_;
+		size_t begin_ = 0;
+		size_t end_ = 0;
+		// every AsyncRead on this stream decodes on it, messages are read one at a time anyway
+		DecoderStack decoderStack;
+	};
+
+	template<typename T, typename Stream>
+	IncrementalReader<T> ReaderFor(Stream& stream)
+	{
+		if constexpr (requires { { stream.decoderStack } -> std::convertible_to<DecoderStack&>; })
+			return IncrementalReader<T>(stream.decoderStack);
+		else
+			return IncrementalReader<T>();
+	}
+
+	// bytes past the end of the value stay buffered in the stream for the next AsyncRead
+	// a stream exposing a decoderStack lends it to every read instead of each one mapping its own
+	template<typename T, AsyncStream Stream>
+	Task<std::variant<T, Error>> AsyncRead(Stream& stream)
+	{
+		auto reader = ReaderFor<T>(stream);
+		for (;;)
+		{
+			std::string_view bytes = co_await stream.Fill();
+			auto status = bytes.empty() ? reader.Finish() : reader.Feed(bytes);
+			stream.Consume(bytes.size() - reader.Rest().size());
+			if (status == ReadStatus::Done)
+				co_return std::move(reader.Value());
+			if (status == ReadStatus::Failed)
+				co_return reader.Failure();
+		}
+	}
+
+	// the task starts lazily, value must stay alive until it is awaited
+	template<AsyncStream Stream, typename T>
+	Task<bool> AsyncWrite(Stream& stream, const T& value)
+	{
+		PooledWriter out;
+		Write(out, value);
+		co_return co_await stream.Write(out.View());
+	}
+}
@@ -0,0 +1,286 @@
+#pragma once
+#include "ZSerializer.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define ZS_CRC32C_HARDWARE 1
+#endif
+
+namespace zs
+{
+	// slice by 8 tables for the reflected polynomial 0x82f63b78, tables[k] advances a byte through k more zero bytes
+	inline constexpr auto crc32cTables = []
+	{
+		std::array<std::array<uint32_t, 256>, 8> tables{};
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t value = i;
+			for (int bit = 0; bit < 8; ++bit)
+				value = (value >> 1) ^ (0x82f63b78 & (0 - (value & 1)));
+			tables[0][i] = value;
+		}
+		for (size_t k = 1; k < 8; ++k)
+			for (size_t i = 0; i < 256; ++i)
+				tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xff];
+		return tables;
+	}();
+
+	inline uint32_t Crc32cSoftware(uint32_t crc, const void* data, size_t bytes)
+	{
+		auto& t = crc32cTables;
+		auto p = static_cast<const uint8_t*>(data);
+		crc = ~crc;
+		for (; bytes >= 8; bytes -= 8, p += 8)
+		{
+			uint32_t low = crc ^ (p[0] | p[1] << 8 | p[2] << 16 | uint32_t(p[3]) << 24);
+			uint32_t high = p[4] | p[5] << 8 | p[6] << 16 | uint32_t(p[7]) << 24;
+			crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+				t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^ t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+		}
+		for (; bytes > 0; --bytes, ++p)
+			crc = t[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	// a * b modulo the polynomial, both in the reflected representation where x^0 is the top bit
+	inline uint32_t Crc32cMultiply(uint32_t a, uint32_t b)
+	{
+		uint32_t product = 0;
+		for (uint32_t bit = uint32_t(1) << 31; bit != 0; bit >>= 1)
+		{
+			if (a & bit)
+				product ^= b;
+			b = b & 1 ? (b >> 1) ^ 0x82f63b78 : b >> 1;
+		}
+		return product;
+	}
+
+	// x^(8 * bytes) modulo the polynomial, CRC(A + B) is Crc32cMultiply(CRC(A), Crc32cShift(|B|)) ^ CRC(B)
+	inline uint32_t Crc32cShift(uint64_t bytes)
+	{
+		uint32_t result = uint32_t(1) << 31;
+		uint32_t power = uint32_t(1) << 23;
+		for (; bytes > 0; bytes >>= 1)
+		{
+			if (bytes & 1)
+				result = Crc32cMultiply(result, power);
+			power = Crc32cMultiply(power, power);
+		}
+		return result;
+	}
+
+#if ZS_CRC32C_HARDWARE
+	// compiled for SSE4.2 regardless of the target flags, only called once the CPU is known to support it
+	// large inputs run three independent streams to hide the latency of crc32, then combine them
+	__attribute__((target("sse4.2"))) inline uint32_t Crc32cHardware(uint32_t crc, const void* data, size_t bytes)
+	{
+		auto p = static_cast<const uint8_t*>(data);
+#if defined(__x86_64__)
+		constexpr size_t stream = 4096;
+		static const uint32_t shift = Crc32cShift(stream);
+		for (; bytes >= 3 * stream; bytes -= 3 * stream, p += 3 * stream)
+		{
+			uint64_t a = ~crc, b = ~uint32_t(0), c = ~uint32_t(0);
+			for (size_t i = 0; i < stream; i += 8)
+			{
+				uint64_t va, vb, vc;
+				std::memcpy(&va, p + i, 8);
+				std::memcpy(&vb, p + stream + i, 8);
+				std::memcpy(&vc, p + 2 * stream + i, 8);
+				a = _mm_crc32_u64(a, va);
+				b = _mm_crc32_u64(b, vb);
+				c = _mm_crc32_u64(c, vc);
+			}
+			crc = Crc32cMultiply(~uint32_t(a), shift) ^ ~uint32_t(b);
+			crc = Crc32cMultiply(crc, shift) ^ ~uint32_t(c);
+		}
+#endif
+		crc = ~crc;
+#if defined(__x86_64__)
+		uint64_t wide = crc;
+		for (; bytes >= 8; bytes -= 8, p += 8)
+		{
+			uint64_t value;
+			std::memcpy(&value, p, 8);
+			wide = _mm_crc32_u64(wide, value);
+		}
+		crc = static_cast<uint32_t>(wide);
+#endif
+		for (; bytes >= 4; bytes -= 4, p += 4)
+		{
+			uint32_t value;
+			std::memcpy(&value, p, 4);
+			crc = _mm_crc32_u32(crc, value);
+		}
+		for (; bytes > 0; --bytes, ++p)
+			crc = _mm_crc32_u8(crc, *p);
+		return ~crc;
+	}
+#endif
+
+	// CRC-32C (Castagnoli), continue a running value by passing it back in
+	// uses the SSE4.2 crc32 instruction when the CPU has it and slice by 8 tables otherwise
+	inline uint32_t Crc32c(uint32_t crc, const void* data, size_t bytes)
+	{
+#if ZS_CRC32C_HARDWARE
+		static const bool hardware = __builtin_cpu_supports("sse4.2");
+		if (hardware)
+			return Crc32cHardware(crc, data, bytes);
+#endif
+		return Crc32cSoftware(crc, data, bytes);
+	}
+
+	template<typename Out>
+	void WriteChecksum(Out& out, uint32_t crc)
+	{
+		uint8_t bytes[4]{ uint8_t(crc), uint8_t(crc >> 8), uint8_t(crc >> 16), uint8_t(crc >> 24) };
+		out.Write(bytes, 4);
+	}
+
+	template<typename In>
+	bool ReadChecksum(In& in, uint32_t& crc)
+	{
+		uint8_t bytes[4];
+		if (!in.Read(bytes, 4))
+			return false;
+		crc = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | uint32_t(bytes[3]) << 24;
+		return true;
+	}
+
+	// passes everything through while computing its CRC-32C, Finish appends it as 4 little endian bytes
+	template<typename Out>
+	struct ChecksumWriter
+	{
+		ChecksumWriter(Out& out)
+			:out_(out){}
+
+		void Write(const void* source, size_t bytes)
+		{
+			crc = Crc32c(crc, source, bytes);
+			out_.Write(source, bytes);
+		}
+
+		void Finish()
+		{
+			WriteChecksum(out_, crc);
+			crc = 0;
+		}
+
+		Out& out_;
+		uint32_t crc = 0;
+	};
+
+	template<typename In>
+	struct ChecksumReader
+	{
+		ChecksumReader(In& in)
+			:in_(in){}
+
+		bool Read(void* dest, size_t bytes)
+		{
+			if (!in_.Read(dest, bytes))
+				return false;
+			crc = Crc32c(crc, dest, bytes);
+			return true;
+		}
+
+		// reads the checksum appended by Finish, true when it matches everything read since the last Verify
+		bool Verify()
+		{
+			uint32_t expected;
+			bool matched = ReadChecksum(in_, expected) && expected == crc;
+			crc = 0;
+			return matched;
+		}
+
+		In& in_;
+		uint32_t crc = 0;
+	};
+
+	// buffers blocks of blockBytes, each written as a varint size, the bytes and their CRC-32C, call Flush after the last write
+	template<typename Out>
+	struct CheckedBlockWriter
+	{
+		CheckedBlockWriter(Out& out, size_t blockBytes = 64 * 1024)
+			:out_(out), blockBytes_(blockBytes), block_(new char[blockBytes]){}
+
+		void Write(const void* source, size_t bytes)
+		{
+			auto p = static_cast<const char*>(source);
+			while (bytes > 0)
+			{
+				size_t n = std::min(bytes, blockBytes_ - used_);
+				std::memcpy(block_.get() + used_, p, n);
+				used_ += n;
+				p += n;
+				bytes -= n;
+				if (used_ == blockBytes_)
+					Flush();
+			}
+		}
+
+		void Flush()
+		{
+			if (used_ == 0)
+				return;
+			WriteVarint(out_, used_);
+			out_.Write(block_.get(), used_);
+			WriteChecksum(out_, Crc32c(0, block_.get(), used_));
+			used_ = 0;
+		}
+
+		Out& out_;
+		size_t blockBytes_;
+		std::unique_ptr<char[]> block_;
+		size_t used_ = 0;
+	};
+
+	// verifies each block before handing out any of its bytes, so corrupt input fails before it reaches a decoder
+	template<typename In>
+	struct CheckedBlockReader
+	{
+		CheckedBlockReader(In& in, size_t maxBlockBytes = 16 << 20)
+			:in_(in), maxBlockBytes_(maxBlockBytes){}
+
+		bool Read(void* dest, size_t bytes)
+		{
+			auto p = static_cast<char*>(dest);
+			while (bytes > 0)
+			{
+				if (position_ == block_.size() && !NextBlock())
+					return false;
+				size_t n = std::min(bytes, block_.size() - position_);
+				std::memcpy(p, block_.data() + position_, n);
+				position_ += n;
+				p += n;
+				bytes -= n;
+			}
+			return true;
+		}
+
+		bool NextBlock()
+		{
+			uint64_t size;
+			uint32_t expected;
+			position_ = 0;
+			block_.clear();
+			if (!ReadVarint(in_, size) || size > maxBlockBytes_)
+				return false;
+			block_.resize(size);
+			if (!in_.Read(block_.data(), size) || !ReadChecksum(in_, expected) || Crc32c(0, block_.data(), size) != expected)
+			{
+				block_.clear();
+				return false;
+			}
+			return true;
+		}
+
+		In& in_;
+		size_t maxBlockBytes_;
+		std::string block_;
+		size_t position_ = 0;
+	};
+}
@@ -0,0 +1,414 @@
+#pragma once
+#include "ZSerializer.hpp"
+#include <memory>
+#include <span>
+#include <unordered_map>
+
+namespace zs
+{
+	// worst case size of LzCompress output for size input bytes
+	inline size_t LzBound(size_t size)
+	{
+		return size + size / 255 + 16;
+	}
+
+	inline uint32_t LzLoad(const char* p)
+	{
+		uint32_t value;
+		std::memcpy(&value, p, 4);
+		return value;
+	}
+
+	inline uint32_t LzHash(uint32_t sequence, int bits)
+	{
+		return (sequence * 2654435761u) >> (32 - bits);
+	}
+
+	// history shared by the compressor and decompressor of small messages, matches may reach back into it
+	// only the last 65535 bytes are kept since that is as far as a match offset goes
+	struct LzDictionary
+	{
+		static constexpr int hashBits = 12;
+
+		LzDictionary() = default;
+
+		explicit LzDictionary(std::string_view bytes)
+			:content(bytes.substr(bytes.size() > 65535 ? bytes.size() - 65535 : 0)), table(size_t(1) << hashBits)
+		{
+			for (size_t i = 0; i + 4 <= content.size(); ++i)
+				table[LzHash(LzLoad(content.data() + i), hashBits)] = static_cast<uint32_t>(i + 1);
+		}
+
+		std::string content;
+		// position + 1 of the last occurrence of each hashed 4 byte sequence, 0 when none
+		std::vector<uint32_t> table;
+	};
+
+	// LZ4 style sequences: a token of literal length and match length - 4 nibbles, both extended by 255 runs,
+	// the literals, then a 2 byte little endian match offset, the last sequence carries literals only
+	// dest needs LzBound(size) bytes, returns the compressed size
+	inline size_t LzCompress(const char* source, size_t size, char* dest, const LzDictionary* dictionary = nullptr)
+	{
+		// small inputs get a small table, clearing it is a noticeable part of compressing a short message
+		const int hashBits = std::clamp(static_cast<int>(std::bit_width(size)), 8, 12);
+		uint32_t table[1 << 12];
+		std::fill_n(table, size_t(1) << hashBits, 0);
+		if (dictionary && dictionary->table.empty())
+			dictionary = nullptr;
+		auto p = reinterpret_cast<const uint8_t*>(source);
+		auto out = reinterpret_cast<uint8_t*>(dest);
+		auto history = dictionary ? reinterpret_cast<const uint8_t*>(dictionary->content.data()) : nullptr;
+		size_t historySize = dictionary ? dictionary->content.size() : 0;
+
+		auto length = [&out](size_t value)
+		{
+			for (; value >= 255; value -= 255)
+				*out++ = 255;
+			*out++ = static_cast<uint8_t>(value);
+		};
+		auto literals = [&](size_t from, size_t to, uint8_t matchNibble)
+		{
+			size_t count = to - from;
+			*out++ = static_cast<uint8_t>((count >= 15 ? 15 : count) << 4 | matchNibble);
+			if (count >= 15)
+				length(count - 15);
+			std::memcpy(out, p + from, count);
+			out += count;
+		};
+
+		size_t anchor = 0;
+		size_t i = 0;
+		while (i + 8 <= size)
+		{
+			uint32_t sequence = LzLoad(source + i);
+			uint32_t hash = LzHash(sequence, hashBits);
+			size_t candidate = table[hash];
+			table[hash] = static_cast<uint32_t>(i);
+			size_t match = 0;
+			size_t offset = 0;
+			if (candidate < i && i - candidate <= 65535 && LzLoad(source + candidate) == sequence)
+			{
+				match = 4;
+				while (i + match < size && p[candidate + match] == p[i + match])
+					++match;
+				while (i > anchor && candidate > 0 && p[i - 1] == p[candidate - 1])
+				{
+					--i;
+					--candidate;
+					++match;
+				}
+				offset = i - candidate;
+			}
+			else if (dictionary)
+			{
+				// matches into the dictionary stop at its end rather than continuing into the input
+				size_t entry = dictionary->table[LzHash(sequence, LzDictionary::hashBits)];
+				if (entry > 0 && historySize - (entry - 1) + i <= 65535 && LzLoad(dictionary->content.data() + entry - 1) == sequence)
+				{
+					candidate = entry - 1;
+					match = 4;
+					while (i + match < size && candidate + match < historySize && history[candidate + match] == p[i + match])
+						++match;
+					while (i > anchor && candidate > 0 && p[i - 1] == history[candidate - 1])
+					{
+						--i;
+						--candidate;
+						++match;
+					}
+					offset = historySize - candidate + i;
+				}
+			}
+			if (match == 0)
+			{
+				// skip faster through data that keeps failing to match
+				i += 1 + ((i - anchor) >> 6);
+				continue;
+			}
+
+			literals(anchor, i, static_cast<uint8_t>(match - 4 >= 15 ? 15 : match - 4));
+			*out++ = static_cast<uint8_t>(offset);
+			*out++ = static_cast<uint8_t>(offset >> 8);
+			if (match - 4 >= 15)
+				length(match - 4 - 15);
+			i += match;
+			anchor = i;
+		}
+		literals(anchor, size, 0);
+		return out - reinterpret_cast<uint8_t*>(dest);
+	}
+
+	// false on malformed input or when the output would not be exactly rawSize bytes
+	// input compressed against a dictionary needs the same dictionary
+	inline bool LzDecompress(const char* source, size_t size, char* dest, size_t rawSize, const LzDictionary* dictionary = nullptr)
+	{
+		auto in = reinterpret_cast<const uint8_t*>(source);
+		auto end = in + size;
+		auto out = reinterpret_cast<uint8_t*>(dest);
+		auto history = dictionary ? reinterpret_cast<const uint8_t*>(dictionary->content.data()) : nullptr;
+		size_t historySize = dictionary ? dictionary->content.size() : 0;
+		size_t written = 0;
+
+		auto length = [&in, end](size_t& value)
+		{
+			uint8_t byte;
+			do
+			{
+				if (in == end)
+					return false;
+				byte = *in++;
+				value += byte;
+			} while (byte == 255);
+			return true;
+		};
+
+		while (in < end)
+		{
+			uint8_t token = *in++;
+			size_t count = token >> 4;
+			if (count == 15 && !length(count))
+				return false;
+			if (count > size_t(end - in) || count > rawSize - written)
+				return false;
+			std::memcpy(out + written, in, count);
+			in += count;
+			written += count;
+			if (in == end)
+				break;
+
+			if (end - in < 2)
+				return false;
+			size_t offset = in[0] | in[1] << 8;
+			in += 2;
+			size_t match = (token & 15) + 4;
+			if ((token & 15) == 15 && !length(match))
+				return false;
+			if (offset == 0 || offset > written + historySize || match > rawSize - written)
+				return false;
+			uint8_t* to = out + written;
+			if (offset > written)
+			{
+				size_t back = offset - written;
+				for (size_t k = 0; k < match; ++k)
+					to[k] = k < back ? history[historySize - back + k] : out[k - back];
+			}
+			else if (offset >= match)
+				std::memcpy(to, to - offset, match);
+			else
+				for (size_t k = 0; k < match; ++k)
+					to[k] = to[k - offset];
+			written += match;
+		}
+		return written == rawSize;
+	}
+
+	// picks segments of the samples whose 8 byte substrings recur across the most samples, greedily so each segment
+	// covers substrings no earlier one did, the most valuable segments end up last, closest to the messages
+	inline LzDictionary TrainDictionary(std::span<const std::string> samples, size_t dictionaryBytes = 4096, size_t segmentBytes = 32)
+	{
+		constexpr size_t gram = 8;
+		auto key = [](const char* p)
+		{
+			uint64_t value;
+			std::memcpy(&value, p, gram);
+			return value;
+		};
+
+		std::unordered_map<uint64_t, uint32_t> frequency;
+		std::vector<uint64_t> seen;
+		for (const auto& sample : samples)
+		{
+			seen.clear();
+			for (size_t i = 0; i + gram <= sample.size(); ++i)
+				seen.push_back(key(sample.data() + i));
+			std::sort(seen.begin(), seen.end());
+			seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+			for (auto k : seen)
+				++frequency[k];
+		}
+		// a substring found in a single sample helps no other message
+		std::erase_if(frequency, [](const auto& entry){ return entry.second < 2; });
+
+		std::vector<std::string_view> segments;
+		size_t total = 0;
+		size_t budget = std::min<size_t>(dictionaryBytes, 65535);
+		std::vector<uint64_t> weights;
+		while (total < budget)
+		{
+			uint64_t bestScore = 0;
+			std::string_view best;
+			for (const auto& sample : samples)
+			{
+				if (sample.size() < gram)
+					continue;
+				weights.assign(sample.size() - gram + 1, 0);
+				for (size_t i = 0; i < weights.size(); ++i)
+					if (auto found = frequency.find(key(sample.data() + i)); found != frequency.end())
+						weights[i] = found->second;
+
+				size_t window = std::min(segmentBytes, sample.size()) - gram + 1;
+				uint64_t score = 0;
+				for (size_t i = 0; i < weights.size(); ++i)
+				{
+					score += weights[i];
+					if (i >= window)
+						score -= weights[i - window];
+					if (i + 1 >= window && score > bestScore)
+					{
+						bestScore = score;
+						size_t begin = i + 1 - window;
+						best = std::string_view(sample).substr(begin, std::min(segmentBytes, budget - total));
+					}
+				}
+			}
+			if (bestScore == 0)
+				break;
+			segments.push_back(best);
+			total += best.size();
+			for (size_t i = 0; i + gram <= best.size(); ++i)
+				frequency.erase(key(best.data() + i));
+		}
+
+		std::string content;
+		content.reserve(total);
+		for (auto segment = segments.rbegin(); segment != segments.rend(); ++segment)
+			content.append(*segment);
+		return LzDictionary(content);
+	}
+
+	// a varint of (stored size << 1 | compressed), the raw size as a varint when compressed, then the stored bytes
+	// blocks that do not shrink are stored as is, scratch needs LzBound(size) bytes
+	template<typename Out>
+	void WriteBlock(Out& out, const char* data, size_t size, char* scratch, const LzDictionary* dictionary = nullptr)
+	{
+		size_t compressed = LzCompress(data, size, scratch, dictionary);
+		if (compressed < size)
+		{
+			WriteVarint(out, compressed << 1 | 1);
+			WriteVarint(out, size);
+			out.Write(scratch, compressed);
+		}
+		else
+		{
+			WriteVarint(out, size << 1);
+			out.Write(data, size);
+		}
+	}
+
+	// compresses everything written into independent blocks of blockBytes, see WriteBlock
+	// with a dictionary every block is compressed against it, call Flush after the last write
+	template<typename Out>
+	struct CompressWriter
+	{
+		CompressWriter(Out& out, size_t blockBytes = 64 * 1024, const LzDictionary* dictionary = nullptr)
+			:out_(out), blockBytes_(blockBytes), block_(new char[blockBytes]), compressed_(new char[LzBound(blockBytes)]), dictionary_(dictionary){}
+
+		void Write(const void* source, size_t bytes)
+		{
+			auto p = static_cast<const char*>(source);
+			while (bytes > 0)
+			{
+				size_t n = std::min(bytes, blockBytes_ - used_);
+				std::memcpy(block_.get() + used_, p, n);
+				used_ += n;
+				p += n;
+				bytes -= n;
+				if (used_ == blockBytes_)
+					Flush();
+			}
+		}
+
+		void Flush()
+		{
+			if (used_ == 0)
+				return;
+			WriteBlock(out_, block_.get(), used_, compressed_.get(), dictionary_);
+			used_ = 0;
+		}
+
+		Out& out_;
+		size_t blockBytes_;
+		std::unique_ptr<char[]> block_;
+		std::unique_ptr<char[]> compressed_;
+		const LzDictionary* dictionary_;
+		size_t used_ = 0;
+	};
+
+	// reads the blocks of CompressWriter one at a time, blocks claiming more than maxBlockBytes are rejected
+	template<typename In>
+	struct DecompressReader
+	{
+		DecompressReader(In& in, size_t maxBlockBytes = 16 << 20, const LzDictionary* dictionary = nullptr)
+			:in_(in), maxBlockBytes_(maxBlockBytes), dictionary_(dictionary){}
+
+		bool Read(void* dest, size_t bytes)
+		{
+			auto p = static_cast<char*>(dest);
+			while (bytes > 0)
+			{
+				if (position_ == block_.size() && !NextBlock())
+					return false;
+				size_t n = std::min(bytes, block_.size() - position_);
+				std::memcpy(p, block_.data() + position_, n);
+				position_ += n;
+				p += n;
+				bytes -= n;
+			}
+			return true;
+		}
+
+		bool NextBlock()
+		{
+			uint64_t header;
+			if (!ReadVarint(in_, header) || (header >> 1) > LzBound(maxBlockBytes_))
+				return false;
+			size_t stored = header >> 1;
+			position_ = 0;
+			if (!(header & 1))
+			{
+				if (stored > maxBlockBytes_)
+					return false;
+				block_.resize(stored);
+				if (in_.Read(block_.data(), stored))
+					return true;
+				block_.clear();
+				return false;
+			}
+			uint64_t raw;
+			if (!ReadVarint(in_, raw) || raw > maxBlockBytes_)
+				return false;
+			compressed_.resize(stored);
+			block_.resize(raw);
+			if (!in_.Read(compressed_.data(), stored) || !LzDecompress(compressed_.data(), stored, block_.data(), raw, dictionary_))
+			{
+				block_.clear();
+				return false;
+			}
+			return true;
+		}
+
+		In& in_;
+		size_t maxBlockBytes_;
+		const LzDictionary* dictionary_;
+		std::string block_;
+		std::string compressed_;
+		size_t position_ = 0;
+	};
+
+	// a single small message as one block compressed against a dictionary trained on similar messages
+	template<typename T, typename Out>
+	void WriteCompressed(Out& out, const T& value, const LzDictionary& dictionary)
+	{
+		PooledWriter raw;
+		Write(raw, value);
+		PooledWriter scratch;
+		scratch.buffer.resize(LzBound(raw.buffer.size()));
+		WriteBlock(out, raw.buffer.data(), raw.buffer.size(), scratch.buffer.data(), &dictionary);
+	}
+
+	template<typename T, typename In>
+	std::variant<T, Error> ReadCompressed(In& in, const LzDictionary& dictionary)
+	{
+		DecompressReader<In> blocks(in, 16 << 20, &dictionary);
+		return Read<T>(blocks);
+	}
+}
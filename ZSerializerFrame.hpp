@@ -0,0 +1,163 @@
+#pragma once
+#include "ZSerializer.hpp"
+#include "ZSerializerChecksum.hpp"
+#include <optional>
+#include <span>
+
+namespace zs
+{
+	// a frame is a varint of (payload size << 2 | has checksum << 1 | has type), the type as a varint when present,
+	// the payload, and the CRC-32C of the payload as 4 little endian bytes when present
+	struct Frame
+	{
+		std::string_view payload;
+		std::optional<uint64_t> type;
+	};
+
+	struct FrameOptions
+	{
+		std::optional<uint64_t> type;
+		bool checksum = false;
+		size_t maxPayloadBytes = size_t(1) << 30;
+	};
+
+	template<typename Out>
+	void WriteFrameHeader(Out& out, size_t payloadBytes, const FrameOptions& options)
+	{
+		WriteVarint(out, uint64_t(payloadBytes) << 2 | uint64_t(options.checksum) << 1 | uint64_t(options.type.has_value()));
+		if (options.type)
+			WriteVarint(out, *options.type);
+	}
+
+	template<typename Out>
+	void WriteFrame(Out& out, std::string_view payload, const FrameOptions& options = {})
+	{
+		WriteFrameHeader(out, payload.size(), options);
+		out.Write(payload.data(), payload.size());
+		if (options.checksum)
+			WriteChecksum(out, Crc32c(0, payload.data(), payload.size()));
+	}
+
+	// payloads are read back by ReadFrame through a plain BufferReader, so they are encoded through out's bytes only,
+	// in the default byte order and without any interning, bit packing or references out may offer
+	template<typename Out>
+	struct FrameSink
+	{
+		FrameSink(Out& out)
+			:out_(out){}
+
+		void Write(const void* source, size_t bytes)
+		{
+			out_.Write(source, bytes);
+		}
+
+		Out& out_;
+	};
+
+	// sizes the value first so it is encoded straight into out without a staging buffer
+	template<typename T, typename Out>
+	void WriteFramed(Out& out, const T& value, const FrameOptions& options = {})
+	{
+		SizeWriter size;
+		Write(size, value);
+		WriteFrameHeader(out, size.size, options);
+		FrameSink<Out> sink(out);
+		if (options.checksum)
+		{
+			ChecksumWriter<FrameSink<Out>> checked(sink);
+			Write(checked, value);
+			checked.Finish();
+		}
+		else
+			Write(sink, value);
+	}
+
+	// appends every complete frame at the start of data to frames in one pass, the payloads point into data
+	// returns the bytes consumed, a trailing partial frame is left for the next call
+	// a bad checksum or an oversized frame is an Error, frames appended before it are intact
+	inline std::variant<size_t, Error> ParseFrames(std::string_view data, std::vector<Frame>& frames, size_t maxPayloadBytes = size_t(1) << 30)
+	{
+		size_t offset = 0;
+		while (offset < data.size())
+		{
+			std::string_view rest = data.substr(offset);
+			uint64_t header;
+			size_t used = DecodeVarint(rest, header);
+			if (used == 0)
+				return rest.size() >= 10 ? std::variant<size_t, Error>(Error{ ErrorKind::Invalid, offset }) : offset;
+			uint64_t payloadBytes = header >> 2;
+			if (payloadBytes > maxPayloadBytes)
+				return Error{ ErrorKind::TooLarge, offset };
+
+			Frame frame;
+			if (header & 1)
+			{
+				uint64_t type;
+				size_t typeBytes = DecodeVarint(rest.substr(used), type);
+				if (typeBytes == 0)
+					return rest.size() - used >= 10 ? std::variant<size_t, Error>(Error{ ErrorKind::Invalid, offset + used }) : offset;
+				frame.type = type;
+				used += typeBytes;
+			}
+			size_t checksumBytes = header & 2 ? 4 : 0;
+			if (rest.size() - used < payloadBytes + checksumBytes)
+				return offset;
+			frame.payload = rest.substr(used, payloadBytes);
+			if (checksumBytes)
+			{
+				auto p = reinterpret_cast<const uint8_t*>(rest.data() + used + payloadBytes);
+				uint32_t expected = p[0] | p[1] << 8 | p[2] << 16 | uint32_t(p[3]) << 24;
+				if (Crc32c(0, frame.payload.data(), frame.payload.size()) != expected)
+					return Error{ ErrorKind::Checksum, offset };
+			}
+			frames.push_back(frame);
+			offset += used + payloadBytes + checksumBytes;
+		}
+		return offset;
+	}
+
+	template<typename T>
+	std::variant<T, Error> ReadFrame(const Frame& frame)
+	{
+		BufferReader in(frame.payload);
+		return Read<T>(in);
+	}
+
+	// a receive buffer for a stream of frames: recv into Space, Commit what arrived, then Extract every complete frame
+	// extracted payloads stay valid until the next call to Space
+	struct FrameReceiver
+	{
+		std::span<char> Space(size_t atLeast = 64 * 1024)
+		{
+			if (begin_ > 0)
+			{
+				std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+				end_ -= begin_;
+				begin_ = 0;
+			}
+			if (buffer_.size() - end_ < atLeast)
+				buffer_.resize(end_ + atLeast);
+			return std::span<char>(buffer_.data() + end_, buffer_.size() - end_);
+		}
+
+		void Commit(size_t bytes)
+		{
+			end_ += bytes;
+		}
+
+		std::variant<size_t, Error> Extract(std::vector<Frame>& frames)
+		{
+			size_t before = frames.size();
+			auto consumed = ParseFrames(std::string_view(buffer_.data() + begin_, end_ - begin_), frames, maxPayloadBytes);
+			if (std::holds_alternative<Error>(consumed))
+				return std::move(std::get<Error>(consumed));
+			begin_ += std::get<size_t>(consumed);
+			return frames.size() - before;
+		}
+
+		size_t maxPayloadBytes = size_t(1) << 30;
+		std::string buffer_;
+		size_t begin_ = 0;
+		size_t end_ = 0;
+	};
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "ZSerializer.hpp"
+#include <memory_resource>
+#include <unordered_map>
+
+namespace zs
+{
+	struct StringHash
+	{
+		using is_transparent = void;
+
+		size_t operator()(std::string_view value) const
+		{
+			return std::hash<std::string_view>{}(value);
+		}
+	};
+
+	// strings are written as a varint of (size << 1) followed by the characters the first time they are seen on the
+	// stream, afterwards as a varint of (index << 1 | 1) into the table of distinct strings seen so far
+	template<typename Out>
+	struct InterningWriter
+	{
+		InterningWriter(Out& out)
+			:out_(out){}
+
+		void Write(const void* source, size_t bytes)
+		{
+			out_.Write(source, bytes);
+		}
+
+		void WriteInterned(std::string_view value)
+		{
+			if (auto found = table_.find(value); found != table_.end())
+				return WriteVarint(out_, uint64_t(found->second) << 1 | 1);
+			table_.emplace(value, table_.size());
+			WriteVarint(out_, uint64_t(value.size()) << 1);
+			out_.Write(value.data(), value.size());
+		}
+
+		Out& out_;
+		std::unordered_map<std::string, uint64_t, StringHash, std::equal_to<>> table_;
+	};
+
+	// keeps every distinct string in an arena, strings read into std::string_view point there and repeated ones share
+	// the characters, the views stay valid as long as the reader
+	template<typename In>
+	struct InterningReader
+	{
+		InterningReader(In& in, size_t maxStringBytes = 16 << 20)
+			:in_(in), maxStringBytes_(maxStringBytes){}
+
+		bool Read(void* dest, size_t bytes)
+		{
+			return in_.Read(dest, bytes);
+		}
+
+		bool ReadInterned(std::string_view& value)
+		{
+			uint64_t tag;
+			if (!ReadVarint(in_, tag))
+				return false;
+			if (tag & 1)
+			{
+				if ((tag >> 1) >= table_.size())
+					return false;
+				value = table_[tag >> 1];
+				return true;
+			}
+			size_t size = tag >> 1;
+			if (size > maxStringBytes_)
+				return false;
+			auto data = static_cast<char*>(arena_.allocate(size ? size : 1, 1));
+			if (!in_.Read(data, size))
+				return false;
+			value = std::string_view(data, size);
+			table_.push_back(value);
+			return true;
+		}
+
+		In& in_;
+		size_t maxStringBytes_;
+		std::pmr::monotonic_buffer_resource arena_;
+		std::vector<std::string_view> table_;
+	};
+}
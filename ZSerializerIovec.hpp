@@ -0,0 +1,119 @@
+#pragma once
+#include "ZSerializer.hpp"
+#include <cerrno>
+#include <climits>
+#include <memory>
+#include <span>
+#include <sys/uio.h>
+
+namespace zs
+{
+	// builds an iovec chain for writev or sendmsg, small writes are appended to inline chunks while contiguous POD
+	// payloads of at least threshold bytes are recorded as references, the written object must outlive the chain
+	struct IovecWriter
+	{
+		explicit IovecWriter(size_t threshold = 16 * 1024, size_t chunkBytes = 4096)
+			:threshold_(threshold), chunkBytes_(chunkBytes){}
+
+		void Write(const void* source, size_t bytes)
+		{
+			if (bytes == 0)
+				return;
+			if (current_ == chunks_.size() || chunks_[current_].size - used_ < bytes)
+				NextChunk(bytes);
+			char* dest = chunks_[current_].data.get() + used_;
+			std::memcpy(dest, source, bytes);
+			used_ += bytes;
+			size_ += bytes;
+			if (!iovecs_.empty() && static_cast<char*>(iovecs_.back().iov_base) + iovecs_.back().iov_len == dest)
+				iovecs_.back().iov_len += bytes;
+			else
+				iovecs_.push_back(iovec{ dest, bytes });
+		}
+
+		void WriteRef(const void* source, size_t bytes)
+		{
+			if (bytes < threshold_)
+				return Write(source, bytes);
+			iovecs_.push_back(iovec{ const_cast<void*>(source), bytes });
+			size_ += bytes;
+		}
+
+		std::span<const iovec> Iovecs() const
+		{
+			return iovecs_;
+		}
+
+		size_t Size() const
+		{
+			return size_;
+		}
+
+		// drops the chain but keeps the inline chunks for the next message
+		void Clear()
+		{
+			iovecs_.clear();
+			current_ = 0;
+			used_ = 0;
+			size_ = 0;
+		}
+
+		// writes the whole chain, retrying partial writes, false on an error other than EINTR
+		bool WriteTo(int fd) const
+		{
+			std::vector<iovec> pending(iovecs_);
+			size_t first = 0;
+			while (first < pending.size())
+			{
+				int count = static_cast<int>(std::min<size_t>(pending.size() - first, IOV_MAX));
+				ssize_t written = writev(fd, pending.data() + first, count);
+				if (written < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					return false;
+				}
+				for (size_t left = written; left > 0;)
+				{
+					size_t step = std::min(left, pending[first].iov_len);
+					pending[first].iov_base = static_cast<char*>(pending[first].iov_base) + step;
+					pending[first].iov_len -= step;
+					left -= step;
+					if (pending[first].iov_len == 0)
+						++first;
+				}
+				while (first < pending.size() && pending[first].iov_len == 0)
+					++first;
+			}
+			return true;
+		}
+
+		void NextChunk(size_t bytes)
+		{
+			if (current_ < chunks_.size())
+				++current_;
+			while (current_ < chunks_.size() && chunks_[current_].size < bytes)
+				++current_;
+			if (current_ == chunks_.size())
+			{
+				size_t size = std::max(bytes, chunkBytes_);
+				chunks_.push_back(Chunk{ std::unique_ptr<char[]>(new char[size]), size });
+			}
+			used_ = 0;
+		}
+
+		struct Chunk
+		{
+			std::unique_ptr<char[]> data;
+			size_t size;
+		};
+
+		size_t threshold_;
+		size_t chunkBytes_;
+		std::vector<Chunk> chunks_;
+		std::vector<iovec> iovecs_;
+		size_t current_ = 0;
+		size_t used_ = 0;
+		size_t size_ = 0;
+	};
+}
@@ -0,0 +1,405 @@
+#pragma once
+#include "ZSerializer.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+namespace zs
+{
+	struct ParallelOptions
+	{
+		size_t chunkElements = 64 * 1024;
+		size_t threads = std::max(1u, std::thread::hardware_concurrency());
+		// ReadParallel fails with TooLarge instead of allocating for headers claiming more than these
+		size_t maxElements = size_t(1) << 28;
+		size_t maxBytes = size_t(1) << 32;
+	};
+
+	// chunks are encoded in memory with the byte order of the stream they are copied to or from
+	template<std::endian order>
+	struct ChunkWriter : BufferWriter
+	{
+		static constexpr std::endian endian = order;
+	};
+
+	template<std::endian order>
+	struct ChunkReader : BufferReader
+	{
+		static constexpr std::endian endian = order;
+
+		using BufferReader::BufferReader;
+	};
+
+	template<typename Func>
+	void RunChunks(size_t chunks, size_t threads, Func&& func)
+	{
+		threads = std::min(threads, chunks);
+		if (threads <= 1)
+		{
+			for (size_t i = 0; i < chunks; ++i)
+				func(i);
+			return;
+		}
+
+		// an exception must not leave a worker thread, the first one is rethrown on the calling thread once all have joined
+		std::atomic<size_t> next{ 0 };
+		std::mutex mutex;
+		std::exception_ptr error;
+		auto work = [&next, &func, &mutex, &error, chunks]()
+		{
+			try
+			{
+				for (size_t i = next++; i < chunks; i = next++)
+					func(i);
+			}
+			catch (...)
+			{
+				std::lock_guard lock(mutex);
+				if (!error)
+					error = std::current_exception();
+				next = chunks;
+			}
+		};
+		std::vector<std::thread> workers;
+		for (size_t i = 1; i < threads; ++i)
+			workers.emplace_back(work);
+		work();
+		for (auto& worker : workers)
+			worker.join();
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	// layout: element count, elements per chunk, encoded byte size of every chunk, then the chunks back to back
+	// chunk boundaries depend only on chunkElements so the output is the same for any number of threads
+	template<typename T, typename Out>
+	void WriteParallel(Out& out, const std::vector<T>& vec, const ParallelOptions& options = {})
+	{
+		size_t chunkElements = std::max<size_t>(options.chunkElements, 1);
+		size_t chunks = (vec.size() + chunkElements - 1) / chunkElements;
+		auto chunkSize = [&vec, chunkElements](size_t chunk)
+		{
+			return std::min(chunkElements, vec.size() - chunk * chunkElements);
+		};
+
+		Write(out, vec.size());
+		Write(out, chunkElements);
+
+		if constexpr (POD<T>)
+		{
+			for (size_t i = 0; i < chunks; ++i)
+				Write(out, chunkSize(i) * sizeof(T));
+			WriteScalars(out, vec.data(), vec.size());
+		}
+		else
+		{
+			std::vector<std::string> buffers(chunks);
+			RunChunks(chunks, options.threads, [&](size_t chunk)
+			{
+				ChunkWriter<WireEndian<Out>> writer;
+				auto begin = vec.begin() + chunk * chunkElements;
+				for (auto it = begin; it != begin + chunkSize(chunk); ++it)
+					Write(writer, *it);
+				buffers[chunk] = std::move(writer.buffer);
+			});
+
+			for (const auto& buffer : buffers)
+				Write(out, buffer.size());
+			for (const auto& buffer : buffers)
+				out.Write(buffer.data(), buffer.size());
+		}
+	}
+
+	// decodes the layout of WriteParallel, every chunk is decoded on a worker straight into its slots of the result
+	template<typename T, typename In>
+	std::variant<std::vector<T>, Error> ReadParallel(In& in, const ParallelOptions& options = {})
+	{
+		ZS_READ(size_t, in, size);
+		ZS_READ(size_t, in, chunkElements);
+		if (size > 0 && chunkElements == 0)
+			return Fail(in, ErrorKind::Invalid);
+		if (size > options.maxElements)
+			return Fail(in, ErrorKind::TooLarge);
+
+		size_t chunks = size > 0 ? (size - 1) / chunkElements + 1 : 0;
+		std::vector<size_t> offsets{ 0 };
+		for (size_t i = 0; i < chunks; ++i)
+		{
+			ZS_READ(size_t, in, bytes);
+			if (bytes > options.maxBytes - offsets.back())
+				return Fail(in, ErrorKind::TooLarge);
+			offsets.push_back(offsets.back() + bytes);
+		}
+
+		std::vector<T> vec;
+		if constexpr (POD<T>)
+		{
+			if (size > options.maxBytes / sizeof(T))
+				return Fail(in, ErrorKind::TooLarge);
+			if (offsets.back() != size * sizeof(T))
+				return Fail(in, ErrorKind::Invalid);
+			vec.resize(size);
+			if (!ReadScalars(in, vec.data(), size))
+				return Fail(in, ErrorKind::Truncated);
+		}
+		else
+		{
+			size_t start = PositionOf(in);
+			std::string payload(offsets.back(), '\0');
+			if (!in.Read(payload.data(), payload.size()))
+				return Fail(in, ErrorKind::Truncated);
+
+			vec.resize(size);
+			std::atomic<bool> failed{ false };
+			std::vector<std::optional<Error>> errors(chunks);
+			RunChunks(chunks, options.threads, [&](size_t chunk)
+			{
+				ChunkReader<WireEndian<In>> reader(std::string_view(payload).substr(offsets[chunk], offsets[chunk + 1] - offsets[chunk]));
+				size_t end = std::min(size, (chunk + 1) * chunkElements);
+				for (size_t i = chunk * chunkElements; i < end && !failed; ++i)
+				{
+					bool read = false;
+					try
+					{
+						read = Read(reader, vec[i]);
+					}
+					// a forged length nested inside an element fails that chunk like any other oversized input
+					catch (const std::bad_alloc&)
+					{
+						LastError() = Fail(reader, ErrorKind::TooLarge);
+					}
+					catch (const std::length_error&)
+					{
+						LastError() = Fail(reader, ErrorKind::TooLarge);
+					}
+					if (!read)
+					{
+						// LastError belongs to this worker thread
+						errors[chunk] = ElementError(LastError(), i);
+						failed = true;
+						return;
+					}
+				}
+				if (reader.offset != reader.data.size())
+				{
+					errors[chunk] = Fail(reader, ErrorKind::Invalid);
+					failed = true;
+				}
+			});
+			// offsets within a chunk become offsets in the stream
+			for (size_t chunk = 0; chunk < chunks; ++chunk)
+			{
+				if (!errors[chunk])
+					continue;
+				Error& error = *errors[chunk];
+				if (start != Error::unknownOffset)
+					error.offset += start + offsets[chunk];
+				else
+					error.offset = Error::unknownOffset;
+				return std::move(error);
+			}
+		}
+		return vec;
+	}
+
+	// member annotation for Trait<T>::members, writes and reads a vector member through WriteParallel/ReadParallel
+	template<typename Member>
+	struct ChunkedMember
+	{
+		using Value = typename MemberPointerTrait<Member>::Type;
+		static_assert(Vector<Value>, "Chunked applies to vector members");
+
+		template<typename Out>
+		void Write(Out& out, const Value& value) const
+		{
+			WriteParallel(out, value, { chunkElements });
+		}
+
+		template<typename In>
+		std::variant<Value, Error> Read(In& in) const
+		{
+			return ReadParallel<typename Value::value_type>(in, { chunkElements });
+		}
+
+		Member member;
+		size_t chunkElements;
+	};
+
+	template<typename Member>
+	constexpr ChunkedMember<Member> Chunked(Member member, size_t chunkElements = ParallelOptions{}.chunkElements)
+	{
+		return { member, chunkElements };
+	}
+
+	// every worker owns a deque of index ranges, it pops its own from the front and steals from the back of the others
+	struct WorkStealingPool
+	{
+		explicit WorkStealingPool(size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+		{
+			threads = std::max<size_t>(threads, 1);
+			for (size_t i = 0; i < threads; ++i)
+				queues_.push_back(std::make_unique<Queue>());
+			for (size_t i = 0; i < threads; ++i)
+				workers_.emplace_back([this, i]{ Work(i); });
+		}
+
+		~WorkStealingPool()
+		{
+			{
+				std::lock_guard lock(mutex_);
+				stop_ = true;
+			}
+			wake_.notify_all();
+			for (auto& worker : workers_)
+				worker.join();
+		}
+
+		size_t Size() const
+		{
+			return workers_.size();
+		}
+
+		// calls func(i) for every i in [0, count) and blocks until all are done, rethrows the first exception
+		void ParallelFor(size_t count, std::function<void(size_t)> func, size_t grain = 0)
+		{
+			if (count == 0)
+				return;
+			std::lock_guard call(call_);
+
+			size_t threads = Size();
+			grain = grain ? grain : std::max<size_t>(1, count / (threads * 8));
+			size_t ranges = 0;
+			{
+				std::lock_guard lock(mutex_);
+				job_ = std::move(func);
+				error_ = nullptr;
+				for (size_t w = 0; w < threads; ++w)
+				{
+					std::lock_guard queueLock(queues_[w]->mutex);
+					for (size_t begin = count * w / threads, end = count * (w + 1) / threads; begin < end; begin += grain)
+					{
+						queues_[w]->ranges.emplace_back(begin, std::min(begin + grain, end));
+						++ranges;
+					}
+				}
+				pending_ = ranges;
+				++generation_;
+			}
+			wake_.notify_all();
+
+			std::unique_lock lock(mutex_);
+			done_.wait(lock, [this]{ return pending_ == 0; });
+			job_ = nullptr;
+			if (error_)
+				std::rethrow_exception(error_);
+		}
+
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<std::pair<size_t, size_t>> ranges;
+		};
+
+		bool Take(size_t worker, std::pair<size_t, size_t>& range)
+		{
+			for (size_t i = 0; i < queues_.size(); ++i)
+			{
+				auto& queue = *queues_[(worker + i) % queues_.size()];
+				std::lock_guard lock(queue.mutex);
+				if (queue.ranges.empty())
+					continue;
+				if (i == 0)
+				{
+					range = queue.ranges.front();
+					queue.ranges.pop_front();
+				}
+				else
+				{
+					range = queue.ranges.back();
+					queue.ranges.pop_back();
+				}
+				return true;
+			}
+			return false;
+		}
+
+		void Work(size_t worker)
+		{
+			size_t seen = 0;
+			while (true)
+			{
+				{
+					std::unique_lock lock(mutex_);
+					wake_.wait(lock, [this, seen]{ return stop_ || generation_ != seen; });
+					if (stop_)
+						return;
+					seen = generation_;
+				}
+
+				std::pair<size_t, size_t> range;
+				while (Take(worker, range))
+				{
+					try
+					{
+						for (size_t i = range.first; i < range.second; ++i)
+							job_(i);
+					}
+					catch (...)
+					{
+						std::lock_guard lock(mutex_);
+						if (!error_)
+							error_ = std::current_exception();
+					}
+
+					std::lock_guard lock(mutex_);
+					if (--pending_ == 0)
+						done_.notify_all();
+				}
+			}
+		}
+
+		std::vector<std::unique_ptr<Queue>> queues_;
+		std::vector<std::thread> workers_;
+		std::mutex call_;
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable done_;
+		std::function<void(size_t)> job_;
+		std::exception_ptr error_;
+		size_t pending_ = 0;
+		size_t generation_ = 0;
+		bool stop_ = false;
+	};
+
+	struct DefaultEncode
+	{
+		template<typename Out, typename T>
+		void operator()(Out& out, const T& value) const
+		{
+			Write(out, value);
+		}
+	};
+
+	// encodes every object of a random access range on pool, encode(out, object) builds whatever writer stack it needs
+	// on top of a BufferWriter whose buffer is moved into the result, so nothing is copied or kept between batches
+	template<typename Range, typename Encode = DefaultEncode>
+	std::vector<std::string> EncodeBatch(WorkStealingPool& pool, const Range& objects, Encode encode = {})
+	{
+		auto begin = std::begin(objects);
+		std::vector<std::string> buffers(std::size(objects));
+		pool.ParallelFor(buffers.size(), [&buffers, &begin, &encode](size_t i)
+		{
+			BufferWriter out;
+			encode(out, begin[i]);
+			buffers[i] = std::move(out.buffer);
+		});
+		return buffers;
+	}
+}
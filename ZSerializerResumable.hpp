@@ -0,0 +1,260 @@
+#pragma once
+#include "ZSerializer.hpp"
+#include <exception>
+#include <memory>
+#include <new>
+#include <utility>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+namespace zs
+{
+	enum class ReadStatus
+	{
+		NeedMore,
+		Done,
+		Failed,
+	};
+
+	// an mmapped stack above a PROT_NONE guard page, readers that never decode at the same time may share one
+	struct DecoderStack
+	{
+		explicit DecoderStack(size_t bytes = 256 * 1024)
+		{
+			size_t page = size_t(sysconf(_SC_PAGESIZE));
+			bytes_ = (bytes + page - 1) / page * page;
+			mappingBytes_ = bytes_ + page;
+			void* mapping = mmap(nullptr, mappingBytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+			if (mapping == MAP_FAILED)
+				throw std::bad_alloc();
+			mapping_ = static_cast<char*>(mapping);
+			// without its guard page deep nesting would overwrite whatever is mapped below instead of faulting
+			if (mprotect(mapping_, page, PROT_NONE) != 0)
+			{
+				munmap(mapping_, mappingBytes_);
+				throw std::bad_alloc();
+			}
+		}
+
+		DecoderStack(const DecoderStack&) = delete;
+		DecoderStack& operator=(const DecoderStack&) = delete;
+
+		~DecoderStack()
+		{
+			munmap(mapping_, mappingBytes_);
+		}
+
+		char* Base() const
+		{
+			return mapping_ + (mappingBytes_ - bytes_);
+		}
+
+		size_t Size() const
+		{
+			return bytes_;
+		}
+
+		char* mapping_;
+		size_t mappingBytes_;
+		size_t bytes_;
+	};
+
+	// decodes a T from input that arrives in arbitrary fragments, the regular Read overloads run on a stack of their own
+	// and are suspended whenever they need more bytes than have been fed, so no byte is ever parsed twice
+	// fed fragments are not retained, the caller may reuse its buffer as soon as Feed returns
+	// input nested so deeply that less than reserveBytes of the stack remain fails with TooLarge
+	template<typename T>
+	struct IncrementalReader
+	{
+		struct Source
+		{
+			bool Read(void* dest, size_t bytes)
+			{
+				char marker;
+				if (&marker < owner_.stack_->Base() + owner_.reserveBytes_)
+				{
+					owner_.overflow_ = true;
+					return false;
+				}
+				auto p = static_cast<char*>(dest);
+				while (bytes > 0)
+				{
+					if (owner_.input_.empty())
+					{
+						if (owner_.finished_ || !owner_.Suspend())
+							return false;
+						continue;
+					}
+					size_t n = std::min(bytes, owner_.input_.size());
+					std::memcpy(p, owner_.input_.data(), n);
+					owner_.input_.remove_prefix(n);
+					owner_.consumed_ += n;
+					p += n;
+					bytes -= n;
+				}
+				return true;
+			}
+
+			// bytes consumed since the start of the message, across all fragments
+			size_t Position() const
+			{
+				return owner_.consumed_;
+			}
+
+			IncrementalReader& owner_;
+		};
+
+		explicit IncrementalReader(size_t stackBytes = 256 * 1024, size_t reserveBytes = 32 * 1024)
+			:owned_(std::make_unique<DecoderStack>(std::max(stackBytes, 2 * reserveBytes))), stack_(owned_.get()), reserveBytes_(reserveBytes){}
+
+		// decodes on a stack that outlives the reader, e.g. one kept by a stream for all its messages
+		explicit IncrementalReader(DecoderStack& stack, size_t reserveBytes = 32 * 1024)
+			:stack_(&stack), reserveBytes_(std::min(reserveBytes, stack.Size() / 2)){}
+
+		IncrementalReader(const IncrementalReader&) = delete;
+		IncrementalReader& operator=(const IncrementalReader&) = delete;
+
+		~IncrementalReader()
+		{
+			Abort();
+		}
+
+		ReadStatus Feed(std::string_view bytes)
+		{
+			if (status_ != ReadStatus::NeedMore)
+				return status_;
+			input_ = bytes;
+			Resume();
+			return status_;
+		}
+
+		// no more input will come, a decode still waiting for bytes fails
+		ReadStatus Finish()
+		{
+			finished_ = true;
+			if (started_ && status_ == ReadStatus::NeedMore)
+				Resume();
+			else if (status_ == ReadStatus::NeedMore)
+			{
+				status_ = ReadStatus::Failed;
+				failure_ = Error{ ErrorKind::Truncated, 0 };
+			}
+			return status_;
+		}
+
+		ReadStatus Status() const
+		{
+			return status_;
+		}
+
+		// bytes of the last fragment left over after the value was complete, typically the start of the next message
+		std::string_view Rest() const
+		{
+			return input_;
+		}
+
+		T& Value()
+		{
+			return *value_;
+		}
+
+		// why the decode failed, when Status is Failed
+		const Error& Failure() const
+		{
+			return failure_;
+		}
+
+		// prepares for the next message, a decode in progress is abandoned
+		void Reset()
+		{
+			Abort();
+			value_.reset();
+			failure_ = {};
+			consumed_ = 0;
+			overflow_ = false;
+			input_ = {};
+			status_ = ReadStatus::NeedMore;
+			started_ = false;
+			finished_ = false;
+			aborted_ = false;
+		}
+
+		bool Suspend()
+		{
+			swapcontext(&decoder_, &caller_);
+			return !aborted_;
+		}
+
+		void Resume()
+		{
+			if (!started_)
+			{
+				started_ = true;
+				getcontext(&decoder_);
+				decoder_.uc_stack.ss_sp = stack_->Base();
+				decoder_.uc_stack.ss_size = stack_->Size();
+				decoder_.uc_link = &caller_;
+				auto self = reinterpret_cast<uintptr_t>(this);
+				makecontext(&decoder_, reinterpret_cast<void(*)()>(&Entry), 2, unsigned(self >> 32), unsigned(self));
+			}
+			swapcontext(&caller_, &decoder_);
+			if (error_)
+				std::rethrow_exception(std::exchange(error_, nullptr));
+		}
+
+		// unwinds a suspended decode so everything it built so far is destroyed
+		void Abort()
+		{
+			if (started_ && status_ == ReadStatus::NeedMore)
+			{
+				aborted_ = true;
+				swapcontext(&caller_, &decoder_);
+				error_ = nullptr;
+			}
+		}
+
+		static void Entry(unsigned high, unsigned low)
+		{
+			auto self = reinterpret_cast<IncrementalReader*>((uintptr_t(high) << 32) | low);
+			try
+			{
+				Source source{ *self };
+				auto result = Read<T>(source);
+				if (std::holds_alternative<Error>(result))
+				{
+					self->failure_ = std::move(std::get<Error>(result));
+					if (self->overflow_)
+						self->failure_.kind = ErrorKind::TooLarge;
+					self->status_ = ReadStatus::Failed;
+				}
+				else
+				{
+					self->value_.emplace(std::move(std::get<T>(result)));
+					self->status_ = ReadStatus::Done;
+				}
+			}
+			catch (...)
+			{
+				self->error_ = std::current_exception();
+				self->status_ = ReadStatus::Failed;
+			}
+		}
+
+		std::unique_ptr<DecoderStack> owned_;
+		DecoderStack* stack_;
+		size_t reserveBytes_;
+		ucontext_t caller_;
+		ucontext_t decoder_;
+		std::string_view input_;
+		std::optional<T> value_;
+		Error failure_;
+		size_t consumed_ = 0;
+		std::exception_ptr error_;
+		ReadStatus status_ = ReadStatus::NeedMore;
+		bool started_ = false;
+		bool finished_ = false;
+		bool aborted_ = false;
+		bool overflow_ = false;
+	};
+}
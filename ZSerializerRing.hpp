@@ -0,0 +1,245 @@
+#pragma once
+#include "ZSerializer.hpp"
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+
+namespace zs
+{
+	// a byte ring of 8 byte aligned records, each starting with a header word holding the payload size + 1
+	// the header is stored last with release semantics, so publishing a record is a single atomic store
+	// the consumer zeroes every record it drains before handing the space back
+	template<bool multiProducer>
+	struct Ring
+	{
+		static constexpr uint64_t skip = uint64_t(1) << 63;
+
+		explicit Ring(size_t capacity)
+			:capacity_(std::bit_ceil(std::max<size_t>(capacity, 64))), words_(new uint64_t[capacity_ / 8]())
+		{
+		}
+
+		size_t Capacity() const
+		{
+			return capacity_;
+		}
+
+		static size_t RecordSize(size_t bytes)
+		{
+			return (bytes + 8 + 7) & ~size_t(7);
+		}
+
+		// claims a record for bytes of payload, fails when the consumer has not freed enough space
+		bool Reserve(size_t bytes, size_t& position)
+		{
+			size_t size = RecordSize(bytes);
+			size_t head = head_.load(std::memory_order_relaxed);
+			while (true)
+			{
+				if (size > capacity_ || head + size - tail_.load(std::memory_order_acquire) > capacity_)
+				{
+					dropped_.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+				if constexpr (multiProducer)
+				{
+					if (head_.compare_exchange_weak(head, head + size, std::memory_order_relaxed))
+						break;
+				}
+				else
+				{
+					head_.store(head + size, std::memory_order_relaxed);
+					break;
+				}
+			}
+			position = head;
+			return true;
+		}
+
+		// bytes a single producer can still write before filling the ring, header included
+		size_t Free() const
+		{
+			return capacity_ - (head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_acquire));
+		}
+
+		void Copy(size_t position, const void* source, size_t bytes)
+		{
+			auto base = reinterpret_cast<char*>(words_.get());
+			size_t offset = position & (capacity_ - 1);
+			size_t first = std::min(bytes, capacity_ - offset);
+			std::memcpy(base + offset, source, first);
+			std::memcpy(base, static_cast<const char*>(source) + first, bytes - first);
+		}
+
+		void Publish(size_t position, size_t bytes, bool skipped = false)
+		{
+			std::atomic_ref<uint64_t> header(words_[(position & (capacity_ - 1)) / 8]);
+			header.store((bytes + 1) | (skipped ? skip : 0), std::memory_order_release);
+		}
+
+		// hands every published record to func in ring order, returns how many records were consumed
+		template<typename Func>
+		size_t Drain(Func&& func)
+		{
+			auto base = reinterpret_cast<char*>(words_.get());
+			size_t tail = tail_.load(std::memory_order_relaxed);
+			size_t count = 0;
+			while (true)
+			{
+				size_t offset = tail & (capacity_ - 1);
+				uint64_t header = std::atomic_ref<uint64_t>(words_[offset / 8]).load(std::memory_order_acquire);
+				if (header == 0)
+					break;
+
+				size_t bytes = size_t(header & ~skip) - 1;
+				size_t size = RecordSize(bytes);
+				size_t begin = (offset + 8) & (capacity_ - 1);
+				if (!(header & skip))
+				{
+					if (begin + bytes <= capacity_)
+						func(std::string_view(base + begin, bytes));
+					else
+					{
+						scratch_.assign(base + begin, capacity_ - begin);
+						scratch_.append(base, bytes - (capacity_ - begin));
+						func(std::string_view(scratch_));
+					}
+					++count;
+				}
+
+				size_t first = std::min(size, capacity_ - offset);
+				std::memset(base + offset, 0, first);
+				std::memset(base, 0, size - first);
+				tail += size;
+				tail_.store(tail, std::memory_order_release);
+			}
+			return count;
+		}
+
+		uint64_t Dropped() const
+		{
+			return dropped_.load(std::memory_order_relaxed);
+		}
+
+		size_t capacity_;
+		std::unique_ptr<uint64_t[]> words_;
+		std::string scratch_;
+		alignas(64) std::atomic<size_t> head_{ 0 };
+		alignas(64) std::atomic<size_t> tail_{ 0 };
+		alignas(64) std::atomic<uint64_t> dropped_{ 0 };
+	};
+
+	using SpscRing = Ring<false>;
+	using MpscRing = Ring<true>;
+
+	// writes one record straight into the ring memory, a message that outgrows its space is dropped at Commit
+	template<bool multiProducer>
+	struct RingWriter
+	{
+		void Write(const void* source, size_t bytes)
+		{
+			if (bytes > limit_ - used_)
+			{
+				overflow_ = true;
+				return;
+			}
+			ring_.Copy(position_ + 8 + used_, source, bytes);
+			used_ += bytes;
+		}
+
+		Ring<multiProducer>& ring_;
+		size_t position_;
+		size_t limit_;
+		size_t used_ = 0;
+		bool overflow_ = false;
+	};
+
+	// single producer: encodes in place against the space currently free and publishes, no size pass needed
+	template<typename T>
+	bool Publish(SpscRing& ring, const T& value)
+	{
+		size_t free = ring.Free();
+		if (free < 8)
+		{
+			ring.dropped_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		RingWriter<false> writer{ ring, ring.head_.load(std::memory_order_relaxed), free - 8 };
+		Write(writer, value);
+		if (writer.overflow_)
+		{
+			ring.dropped_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		size_t position;
+		if (!ring.Reserve(writer.used_, position))
+			return false;
+		ring.Publish(position, writer.used_);
+		return true;
+	}
+
+	// multiple producers: sizes the message first so the record can be claimed with one CAS, then encodes in place
+	template<typename T>
+	bool Publish(MpscRing& ring, const T& value)
+	{
+		SizeWriter sizer;
+		Write(sizer, value);
+		size_t position;
+		if (!ring.Reserve(sizer.size, position))
+			return false;
+		RingWriter<true> writer{ ring, position, sizer.size };
+		Write(writer, value);
+		ring.Publish(position, sizer.size, writer.overflow_ || writer.used_ != sizer.size);
+		return !writer.overflow_;
+	}
+
+	// writes every record to a file descriptor such as a file or a socket, back to back
+	struct FdSink
+	{
+		void operator()(std::string_view record) const
+		{
+			while (!record.empty())
+			{
+				auto written = ::write(fd, record.data(), record.size());
+				if (written < 0 && errno == EINTR)
+					continue;
+				if (written <= 0)
+					return;
+				record.remove_prefix(size_t(written));
+			}
+		}
+
+		int fd;
+	};
+
+	// drains a ring on a background thread until destroyed, then drains what is left
+	template<typename Ring, typename Sink>
+	struct RingConsumer
+	{
+		RingConsumer(Ring& ring, Sink sink, std::chrono::microseconds idle = std::chrono::microseconds(50))
+			:ring_(ring), sink_(std::move(sink)), thread_([this, idle]
+			{
+				while (!stop_.load(std::memory_order_acquire))
+					if (ring_.Drain(sink_) == 0)
+						std::this_thread::sleep_for(idle);
+				ring_.Drain(sink_);
+			})
+		{
+		}
+
+		~RingConsumer()
+		{
+			stop_.store(true, std::memory_order_release);
+			thread_.join();
+		}
+
+		Ring& ring_;
+		Sink sink_;
+		std::atomic<bool> stop_{ false };
+		std::thread thread_;
+	};
+}
@@ -0,0 +1,502 @@
+#pragma once
+#include "ZSerializer.hpp"
+#include <atomic>
+#include <cerrno>
+#include <memory>
+#include <optional>
+#include <fcntl.h>
+#include <unistd.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define ZS_HAS_URING 1
+#endif
+
+namespace zs
+{
+#if ZS_HAS_URING
+	// the few io_uring operations the file writer and reader need, on the raw system calls so liburing is not required
+	// Ok is false when the kernel or a sandbox refuses io_uring_setup
+	struct Uring
+	{
+		explicit Uring(unsigned entries)
+		{
+			io_uring_params params{};
+			fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+			if (fd_ < 0)
+				return;
+			sqBytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+			cqBytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+			if (single)
+				sqBytes_ = cqBytes_ = std::max(sqBytes_, cqBytes_);
+			sqesBytes_ = params.sq_entries * sizeof(io_uring_sqe);
+
+			sq_ = Map(sqBytes_, IORING_OFF_SQ_RING);
+			cq_ = single ? sq_ : Map(cqBytes_, IORING_OFF_CQ_RING);
+			sqes_ = static_cast<io_uring_sqe*>(Map(sqesBytes_, IORING_OFF_SQES));
+			if (!sq_ || !cq_ || !sqes_)
+			{
+				Close();
+				return;
+			}
+			auto sq = static_cast<char*>(sq_);
+			auto cq = static_cast<char*>(cq_);
+			sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+			sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+			sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+			sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+			cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+			cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+			cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+			cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+			entries_ = params.sq_entries;
+			tail_ = *sqTail_;
+			submitted_ = tail_;
+		}
+
+		Uring(const Uring&) = delete;
+		Uring& operator=(const Uring&) = delete;
+
+		~Uring()
+		{
+			Close();
+		}
+
+		bool Ok() const
+		{
+			return fd_ >= 0;
+		}
+
+		// queues a read or write of bytes at offset, user tags the completion
+		bool Queue(uint8_t opcode, int fd, void* data, size_t bytes, uint64_t offset, uint64_t user)
+		{
+			if (tail_ - std::atomic_ref<unsigned>(*sqHead_).load(std::memory_order_acquire) >= entries_)
+				return false;
+			unsigned index = tail_ & sqMask_;
+			io_uring_sqe& sqe = sqes_[index];
+			std::memset(&sqe, 0, sizeof(sqe));
+			sqe.opcode = opcode;
+			sqe.fd = fd;
+			sqe.addr = reinterpret_cast<uint64_t>(data);
+			sqe.len = static_cast<unsigned>(bytes);
+			sqe.off = offset;
+			sqe.user_data = user;
+			sqArray_[index] = index;
+			++tail_;
+			return true;
+		}
+
+		// hands queued entries to the kernel and optionally blocks until at least one completion is ready
+		bool Submit(bool wait)
+		{
+			std::atomic_ref<unsigned>(*sqTail_).store(tail_, std::memory_order_release);
+			for (;;)
+			{
+				long result = syscall(__NR_io_uring_enter, fd_, tail_ - submitted_, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+				if (result >= 0)
+				{
+					submitted_ += static_cast<unsigned>(result);
+					return true;
+				}
+				if (errno != EINTR)
+					return false;
+			}
+		}
+
+		// drops entries queued but never handed to the kernel, passing each one's user tag to drop
+		template<typename Drop>
+		void Discard(Drop&& drop)
+		{
+			for (unsigned i = submitted_; i != tail_; ++i)
+				drop(sqes_[i & sqMask_].user_data);
+			tail_ = submitted_;
+			std::atomic_ref<unsigned>(*sqTail_).store(tail_, std::memory_order_release);
+		}
+
+		bool Pop(io_uring_cqe& cqe)
+		{
+			unsigned head = *cqHead_;
+			if (head == std::atomic_ref<unsigned>(*cqTail_).load(std::memory_order_acquire))
+				return false;
+			cqe = cqes_[head & cqMask_];
+			std::atomic_ref<unsigned>(*cqHead_).store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		void* Map(size_t bytes, off_t offset)
+		{
+			void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+			return p == MAP_FAILED ? nullptr : p;
+		}
+
+		void Close()
+		{
+			if (sqes_)
+				munmap(sqes_, sqesBytes_);
+			if (cq_ && cq_ != sq_)
+				munmap(cq_, cqBytes_);
+			if (sq_)
+				munmap(sq_, sqBytes_);
+			if (fd_ >= 0)
+				close(fd_);
+			fd_ = -1;
+		}
+
+		int fd_ = -1;
+		void* sq_ = nullptr;
+		void* cq_ = nullptr;
+		io_uring_sqe* sqes_ = nullptr;
+		size_t sqBytes_ = 0;
+		size_t cqBytes_ = 0;
+		size_t sqesBytes_ = 0;
+		unsigned* sqHead_ = nullptr;
+		unsigned* sqTail_ = nullptr;
+		unsigned* sqArray_ = nullptr;
+		unsigned* cqHead_ = nullptr;
+		unsigned* cqTail_ = nullptr;
+		io_uring_cqe* cqes_ = nullptr;
+		unsigned sqMask_ = 0;
+		unsigned cqMask_ = 0;
+		unsigned entries_ = 0;
+		unsigned tail_ = 0;
+		unsigned submitted_ = 0;
+	};
+#else
+	struct Uring
+	{
+		explicit Uring(unsigned){}
+
+		bool Ok() const
+		{
+			return false;
+		}
+
+		bool Queue(uint8_t, int, void*, size_t, uint64_t, uint64_t)
+		{
+			return false;
+		}
+
+		bool Submit(bool)
+		{
+			return false;
+		}
+	};
+#endif
+
+	struct UringOptions
+	{
+		size_t bufferBytes = 1 << 20;
+		size_t buffers = 4;
+		// false forces the plain pread/pwrite path
+		bool uring = true;
+	};
+
+	// shared by UringWriter and UringReader: buffers cycle through the ring, each with at most one request in flight,
+	// short transfers are resubmitted for the remainder
+	struct UringFile
+	{
+		struct Buffer
+		{
+			std::unique_ptr<char[]> data;
+			size_t size = 0;
+			size_t done = 0;
+			uint64_t offset = 0;
+			bool busy = false;
+		};
+
+		UringFile(int fd, const UringOptions& options)
+			:fd_(fd), bufferBytes_(options.bufferBytes), buffers_(std::max<size_t>(options.buffers, 1))
+		{
+			for (auto& buffer : buffers_)
+				buffer.data.reset(new char[bufferBytes_]);
+			off_t offset = lseek(fd, 0, SEEK_CUR);
+			offset_ = offset < 0 ? 0 : uint64_t(offset);
+			if (options.uring && offset >= 0)
+				ring_.emplace(static_cast<unsigned>(buffers_.size()));
+		}
+
+		bool UsingUring() const
+		{
+			return ring_ && ring_->Ok();
+		}
+
+		void Start(size_t index, uint8_t opcode)
+		{
+			auto& buffer = buffers_[index];
+			buffer.busy = ring_->Queue(opcode, fd_, buffer.data.get() + buffer.done, buffer.size - buffer.done, buffer.offset + buffer.done, index);
+			if (!buffer.busy)
+				failed_ = true;
+		}
+
+		// submits queued requests and handles completions, blocking for at least one when wait is set
+		void Reap(bool wait, uint8_t opcode)
+		{
+#if ZS_HAS_URING
+			if (!ring_->Submit(wait))
+			{
+				// buffers whose requests never reached the kernel are free again, the others stay busy until they complete
+				failed_ = true;
+				size_t dropped = 0;
+				ring_->Discard([this, &dropped](uint64_t user)
+				{
+					buffers_[user].busy = false;
+					++dropped;
+				});
+				if (dropped == 0)
+				{
+					// nothing can be waited for either, so buffers the kernel may still write are leaked rather than reused
+					for (auto& buffer : buffers_)
+					{
+						if (!buffer.busy)
+							continue;
+						buffer.data.release();
+						buffer.data.reset(new char[bufferBytes_]);
+						buffer.busy = false;
+					}
+					return;
+				}
+			}
+			io_uring_cqe cqe;
+			while (ring_->Pop(cqe))
+			{
+				auto& buffer = buffers_[cqe.user_data];
+				if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+					Start(cqe.user_data, opcode);
+				else if (cqe.res < 0)
+				{
+					failed_ = true;
+					buffer.busy = false;
+				}
+				else if (cqe.res > 0 && (buffer.done += cqe.res) < buffer.size)
+					Start(cqe.user_data, opcode);
+				else
+				{
+					// a zero byte read is the end of the file, the buffer keeps what it got
+					buffer.size = buffer.done;
+					buffer.busy = false;
+				}
+			}
+#endif
+		}
+
+		void Wait(size_t index, uint8_t opcode)
+		{
+			while (buffers_[index].busy)
+				Reap(true, opcode);
+		}
+
+		void WaitAll(uint8_t opcode)
+		{
+			for (size_t i = 0; i < buffers_.size(); ++i)
+				Wait(i, opcode);
+		}
+
+		int fd_;
+		size_t bufferBytes_;
+		std::vector<Buffer> buffers_;
+		std::optional<Uring> ring_;
+		uint64_t offset_ = 0;
+		bool failed_ = false;
+	};
+
+#if ZS_HAS_URING
+	inline constexpr uint8_t uringWrite = IORING_OP_WRITE;
+	inline constexpr uint8_t uringRead = IORING_OP_READ;
+#else
+	inline constexpr uint8_t uringWrite = 0;
+	inline constexpr uint8_t uringRead = 0;
+#endif
+
+	// writes a file from its current offset through io_uring with several buffers in flight, so encoding into the next
+	// buffer overlaps the kernel writing the previous ones, and falls back to pwrite when io_uring is unavailable
+	// Flush waits for everything and moves the file offset past the written bytes, like write would have
+	struct UringWriter
+	{
+		UringWriter(int fd, const UringOptions& options = {})
+			:file_(fd, options){}
+
+		UringWriter(const UringWriter&) = delete;
+		UringWriter& operator=(const UringWriter&) = delete;
+
+		~UringWriter()
+		{
+			Flush();
+		}
+
+		void Write(const void* source, size_t bytes)
+		{
+			auto p = static_cast<const char*>(source);
+			while (bytes > 0)
+			{
+				auto& buffer = file_.buffers_[current_];
+				size_t n = std::min(bytes, file_.bufferBytes_ - used_);
+				std::memcpy(buffer.data.get() + used_, p, n);
+				used_ += n;
+				p += n;
+				bytes -= n;
+				if (used_ == file_.bufferBytes_)
+					Dispatch();
+			}
+		}
+
+		// false if any write failed
+		bool Flush()
+		{
+			if (used_ > 0)
+				Dispatch();
+			if (file_.UsingUring())
+			{
+				file_.WaitAll(uringWrite);
+				lseek(file_.fd_, off_t(file_.offset_), SEEK_SET);
+			}
+			return !file_.failed_;
+		}
+
+		bool UsingUring() const
+		{
+			return file_.UsingUring();
+		}
+
+		void Dispatch()
+		{
+			auto& buffer = file_.buffers_[current_];
+			buffer.size = used_;
+			buffer.done = 0;
+			buffer.offset = file_.offset_;
+			file_.offset_ += used_;
+			used_ = 0;
+			if (file_.UsingUring())
+			{
+				file_.Start(current_, uringWrite);
+				file_.Reap(false, uringWrite);
+				current_ = (current_ + 1) % file_.buffers_.size();
+				file_.Wait(current_, uringWrite);
+			}
+			else
+			{
+				while (buffer.done < buffer.size)
+				{
+					ssize_t written = ::write(file_.fd_, buffer.data.get() + buffer.done, buffer.size - buffer.done);
+					if (written < 0 && errno == EINTR)
+						continue;
+					if (written <= 0)
+					{
+						file_.failed_ = true;
+						break;
+					}
+					buffer.done += written;
+				}
+			}
+		}
+
+		UringFile file_;
+		size_t current_ = 0;
+		size_t used_ = 0;
+	};
+
+	// reads a file from its current offset with the following blocks already queued to io_uring while one is consumed,
+	// falls back to plain reads when io_uring is unavailable, the file offset is left just past the consumed bytes
+	struct UringReader
+	{
+		UringReader(int fd, const UringOptions& options = {})
+			:file_(fd, options)
+		{
+			consumed_ = file_.offset_;
+			if (file_.UsingUring())
+			{
+				for (size_t i = 0; i < file_.buffers_.size(); ++i)
+					Queue(i);
+				file_.Reap(false, uringRead);
+			}
+		}
+
+		UringReader(const UringReader&) = delete;
+		UringReader& operator=(const UringReader&) = delete;
+
+		~UringReader()
+		{
+			if (file_.UsingUring())
+				file_.WaitAll(uringRead);
+			// the fallback has read ahead too, by up to a block
+			lseek(file_.fd_, off_t(consumed_), SEEK_SET);
+		}
+
+		bool Read(void* dest, size_t bytes)
+		{
+			auto p = static_cast<char*>(dest);
+			while (bytes > 0)
+			{
+				if (!Available() && !NextBlock())
+					return false;
+				auto& buffer = file_.buffers_[current_];
+				size_t n = std::min(bytes, buffer.size - position_);
+				std::memcpy(p, buffer.data.get() + position_, n);
+				position_ += n;
+				consumed_ += n;
+				p += n;
+				bytes -= n;
+			}
+			return true;
+		}
+
+		bool UsingUring() const
+		{
+			return file_.UsingUring();
+		}
+
+		bool Available() const
+		{
+			return started_ && position_ < file_.buffers_[current_].size;
+		}
+
+		void Queue(size_t index)
+		{
+			auto& buffer = file_.buffers_[index];
+			buffer.size = file_.bufferBytes_;
+			buffer.done = 0;
+			buffer.offset = file_.offset_;
+			file_.offset_ += file_.bufferBytes_;
+			file_.Start(index, uringRead);
+		}
+
+		bool NextBlock()
+		{
+			if (ended_ || file_.failed_)
+				return false;
+			if (file_.UsingUring())
+			{
+				if (started_)
+				{
+					Queue(current_);
+					current_ = (current_ + 1) % file_.buffers_.size();
+				}
+				file_.Wait(current_, uringRead);
+				ended_ = file_.buffers_[current_].size < file_.bufferBytes_;
+			}
+			else
+			{
+				auto& buffer = file_.buffers_[current_];
+				ssize_t got;
+				do
+					got = ::read(file_.fd_, buffer.data.get(), file_.bufferBytes_);
+				while (got < 0 && errno == EINTR);
+				if (got < 0)
+					file_.failed_ = true;
+				buffer.size = got < 0 ? 0 : size_t(got);
+				ended_ = got <= 0;
+			}
+			started_ = true;
+			position_ = 0;
+			return file_.buffers_[current_].size > 0 && !file_.failed_;
+		}
+
+		UringFile file_;
+		size_t current_ = 0;
+		size_t position_ = 0;
+		uint64_t consumed_ = 0;
+		bool started_ = false;
+		bool ended_ = false;
+	};
+}
@@ -0,0 +1,291 @@
+#include <benchmark/benchmark.h>
+
+// every allocation on the benchmark thread is counted, benchmarks report the delta over their timed loop
+#define ZS_INSTRUMENT
+#include "../ZSerializer.hpp"
+#include "../ZSerializerUring.hpp"
+#include "../ZSerializerChecksum.hpp"
+#include <cstdint>
+#include <cstdio>
+
+ZS_COUNTING_NEW
+
+struct Vec3
+{
+    float x, y, z;
+};
+
+struct State
+{
+    std::string name;
+    float hp;
+    Vec3 pos;
+    Vec3 vel;
+};
+
+namespace zs
+{
+    template<>
+    struct Trait<State> : public WriteMembers<State>, public ReadMembers<State>
+    {
+        static constexpr auto members = std::make_tuple
+        (
+            &State::name,
+            &State::hp,
+            &State::pos,
+            &State::vel
+        );
+    };
+}
+
+template<typename T>
+T Make();
+
+template<>
+int64_t Make<int64_t>()
+{
+    return 0x123456789;
+}
+
+template<>
+std::string Make<std::string>()
+{
+    return std::string(1024, 'x');
+}
+
+template<>
+std::optional<std::string> Make<std::optional<std::string>>()
+{
+    return "the quick brown fox";
+}
+
+template<>
+std::vector<float> Make<std::vector<float>>()
+{
+    return std::vector<float>(64 * 1024, 3.f);
+}
+
+template<>
+std::vector<std::string> Make<std::vector<std::string>>()
+{
+    return std::vector<std::string>(1024, "jumps over the lazy dog");
+}
+
+template<>
+std::array<float, 64> Make<std::array<float, 64>>()
+{
+    std::array<float, 64> arr;
+    arr.fill(12.f);
+    return arr;
+}
+
+template<>
+std::array<std::string, 16> Make<std::array<std::string, 16>>()
+{
+    std::array<std::string, 16> arr;
+    arr.fill("lazy dog");
+    return arr;
+}
+
+template<>
+State Make<State>()
+{
+    return State{ "tom", 99.f, {3.f,10.f,99.f}, {1.4f,0.f,3.f} };
+}
+
+template<>
+std::vector<State> Make<std::vector<State>>()
+{
+    return std::vector<State>(1024, Make<State>());
+}
+
+struct ByteStream
+{
+    template<typename T>
+    static std::string Encode(const T& value)
+    {
+        zs::StringWriter out;
+        zs::Write(out, value);
+        return out.String();
+    }
+
+    template<typename T>
+    static bool Decode(const std::string& data)
+    {
+        zs::StringReader in(data);
+        auto result = zs::Read<T>(in);
+        benchmark::DoNotOptimize(result);
+        return std::holds_alternative<T>(result);
+    }
+};
+
+struct BitStream
+{
+    template<typename T>
+    static std::string Encode(const T& value)
+    {
+        zs::StringWriter out;
+        zs::BitWriter bits(out);
+        zs::Write(bits, value);
+        bits.Flush();
+        return out.String();
+    }
+
+    template<typename T>
+    static bool Decode(const std::string& data)
+    {
+        zs::StringReader in(data);
+        zs::BitReader bits(in);
+        auto result = zs::Read<T>(bits);
+        benchmark::DoNotOptimize(result);
+        return std::holds_alternative<T>(result);
+    }
+};
+
+void Report(benchmark::State& state, size_t bytes, size_t allocationsBefore)
+{
+    state.SetBytesProcessed(int64_t(bytes * state.iterations()));
+    state.counters["bytes"] = double(bytes);
+    state.counters["allocs/op"] = benchmark::Counter(double(zs::Instrumentation::allocations - allocationsBefore), benchmark::Counter::kAvgIterations);
+}
+
+template<typename Stream, typename T>
+void Write(benchmark::State& state)
+{
+    T value = Make<T>();
+    size_t bytes = Stream::Encode(value).size();
+    size_t before = zs::Instrumentation::allocations;
+    for (auto _ : state)
+    {
+        auto data = Stream::Encode(value);
+        benchmark::DoNotOptimize(data);
+    }
+    Report(state, bytes, before);
+}
+
+template<typename Stream, typename T>
+void Read(benchmark::State& state)
+{
+    auto data = Stream::Encode(Make<T>());
+    size_t before = zs::Instrumentation::allocations;
+    for (auto _ : state)
+    {
+        if (!Stream::template Decode<T>(data))
+        {
+            state.SkipWithError("decode failed");
+            break;
+        }
+    }
+    Report(state, data.size(), before);
+}
+
+#define ZS_BENCHMARK(stream, ...)\
+    BENCHMARK_TEMPLATE(Write, stream, __VA_ARGS__);\
+    BENCHMARK_TEMPLATE(Read, stream, __VA_ARGS__)
+
+#define ZS_BENCHMARK_ALL(stream)\
+    ZS_BENCHMARK(stream, int64_t);\
+    ZS_BENCHMARK(stream, std::string);\
+    ZS_BENCHMARK(stream, std::optional<std::string>);\
+    ZS_BENCHMARK(stream, std::vector<float>);\
+    ZS_BENCHMARK(stream, std::vector<std::string>);\
+    ZS_BENCHMARK(stream, std::array<float, 64>);\
+    ZS_BENCHMARK(stream, std::array<std::string, 16>);\
+    ZS_BENCHMARK(stream, State);\
+    ZS_BENCHMARK(stream, std::vector<State>)
+
+ZS_BENCHMARK_ALL(ByteStream);
+ZS_BENCHMARK_ALL(BitStream);
+
+// a snapshot of 1024 States written 1024 times, about 40 MB per iteration, through io_uring or the plain fd fallback
+template<bool uring>
+void FileWrite(benchmark::State& state)
+{
+    auto value = Make<std::vector<State>>();
+    FILE* file = std::tmpfile();
+    int fd = fileno(file);
+    zs::UringOptions options;
+    options.uring = uring;
+    size_t bytes = 0;
+    for (auto _ : state)
+    {
+        ftruncate(fd, 0);
+        lseek(fd, 0, SEEK_SET);
+        zs::UringWriter out(fd, options);
+        for (int i = 0; i < 1024; ++i)
+            zs::Write(out, value);
+        if (!out.Flush())
+        {
+            state.SkipWithError("write failed");
+            break;
+        }
+        bytes = size_t(lseek(fd, 0, SEEK_CUR));
+    }
+    std::fclose(file);
+    state.SetBytesProcessed(int64_t(bytes * state.iterations()));
+}
+
+template<bool uring>
+void FileRead(benchmark::State& state)
+{
+    FILE* file = std::tmpfile();
+    int fd = fileno(file);
+    {
+        auto value = Make<std::vector<State>>();
+        zs::UringWriter out(fd);
+        for (int i = 0; i < 1024; ++i)
+            zs::Write(out, value);
+    }
+    size_t bytes = size_t(lseek(fd, 0, SEEK_CUR));
+    zs::UringOptions options;
+    options.uring = uring;
+    for (auto _ : state)
+    {
+        lseek(fd, 0, SEEK_SET);
+        zs::UringReader in(fd, options);
+        for (int i = 0; i < 1024; ++i)
+        {
+            auto result = zs::Read<std::vector<State>>(in);
+            if (!std::holds_alternative<std::vector<State>>(result))
+            {
+                state.SkipWithError("read failed");
+                break;
+            }
+        }
+    }
+    std::fclose(file);
+    state.SetBytesProcessed(int64_t(bytes * state.iterations()));
+}
+
+// checksum throughput over 1 MB against a plain copy of the same bytes
+template<uint32_t(*checksum)(uint32_t, const void*, size_t)>
+void Checksum(benchmark::State& state)
+{
+    std::string data(1 << 20, 'x');
+    for (auto _ : state)
+        benchmark::DoNotOptimize(checksum(0, data.data(), data.size()));
+    state.SetBytesProcessed(int64_t(data.size() * state.iterations()));
+}
+
+void Memcpy(benchmark::State& state)
+{
+    std::string data(1 << 20, 'x');
+    std::string copy(data.size(), '\0');
+    for (auto _ : state)
+    {
+        std::memcpy(copy.data(), data.data(), data.size());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(int64_t(data.size() * state.iterations()));
+}
+
+BENCHMARK_TEMPLATE(Checksum, zs::Crc32c);
+BENCHMARK_TEMPLATE(Checksum, zs::Crc32cSoftware);
+BENCHMARK(Memcpy);
+
+BENCHMARK_TEMPLATE(FileWrite, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(FileWrite, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(FileRead, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(FileRead, false)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,244 @@
+// peak heap bytes per run come from the counting allocator, the same one bench.cpp uses
+#define ZS_INSTRUMENT
+#include "../ZSerializer.hpp"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+
+#if defined(ZS_COMPARE_BOOST)
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+#endif
+
+ZS_COUNTING_NEW
+
+struct Vec3
+{
+    float x, y, z;
+    bool operator ==(const Vec3&) const = default;
+};
+
+struct State
+{
+    std::string name;
+    float hp;
+    Vec3 pos;
+    Vec3 vel;
+    bool operator ==(const State&) const = default;
+};
+
+struct Record
+{
+    std::string name;
+    std::string email;
+    std::string address;
+    std::vector<std::string> tags;
+    bool operator ==(const Record&) const = default;
+};
+
+struct Node
+{
+    int32_t value;
+    std::vector<Node> children;
+    bool operator ==(const Node&) const = default;
+};
+
+namespace zs
+{
+    template<>
+    struct Trait<State> : public WriteMembers<State>, public ReadMembers<State>
+    {
+        static constexpr auto members = std::make_tuple(&State::name, &State::hp, &State::pos, &State::vel);
+    };
+
+    template<>
+    struct Trait<Record> : public WriteMembers<Record>, public ReadMembers<Record>
+    {
+        static constexpr auto members = std::make_tuple(&Record::name, &Record::email, &Record::address, &Record::tags);
+    };
+
+    template<>
+    struct Trait<Node> : public WriteMembers<Node>, public ReadMembers<Node>
+    {
+        static constexpr auto members = std::make_tuple(&Node::value, &Node::children);
+    };
+}
+
+struct ZSerializerCodec
+{
+    static constexpr const char* name = "ZSerializer";
+
+    template<typename T>
+    static std::string Encode(const T& value)
+    {
+        zs::StringWriter out;
+        zs::Write(out, value);
+        return out.String();
+    }
+
+    template<typename T>
+    static bool Decode(const std::string& data, T& value)
+    {
+        zs::StringReader in(data);
+        auto result = zs::Read<T>(in);
+        if (!std::holds_alternative<T>(result))
+            return false;
+        value = std::move(std::get<T>(result));
+        return true;
+    }
+};
+
+#if defined(ZS_COMPARE_BOOST)
+namespace boost::serialization
+{
+    template<typename Archive>
+    void serialize(Archive& ar, Vec3& v, unsigned)
+    {
+        ar & v.x & v.y & v.z;
+    }
+
+    template<typename Archive>
+    void serialize(Archive& ar, State& s, unsigned)
+    {
+        ar & s.name & s.hp & s.pos & s.vel;
+    }
+
+    template<typename Archive>
+    void serialize(Archive& ar, Record& r, unsigned)
+    {
+        ar & r.name & r.email & r.address & r.tags;
+    }
+
+    template<typename Archive>
+    void serialize(Archive& ar, Node& n, unsigned)
+    {
+        ar & n.value & n.children;
+    }
+}
+
+struct BoostCodec
+{
+    static constexpr const char* name = "boost binary";
+
+    template<typename T>
+    static std::string Encode(const T& value)
+    {
+        std::ostringstream os;
+        {
+            boost::archive::binary_oarchive ar(os, boost::archive::no_header);
+            ar << value;
+        }
+        return os.str();
+    }
+
+    template<typename T>
+    static bool Decode(const std::string& data, T& value)
+    {
+        std::istringstream is(data);
+        try
+        {
+            boost::archive::binary_iarchive ar(is, boost::archive::no_header);
+            ar >> value;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+        return true;
+    }
+};
+#endif
+
+struct Result
+{
+    double encodeMBps;
+    double decodeMBps;
+    size_t size;
+    size_t peak;
+    bool ok;
+};
+
+template<typename Codec, typename T>
+Result Run(const std::vector<T>& messages, int repeat)
+{
+    using Clock = std::chrono::steady_clock;
+    Result result{ 0, 0, 0, 0, true };
+    auto base = zs::Instrumentation::liveBytes;
+    zs::Instrumentation::peakBytes = base;
+
+    std::vector<std::string> encoded(messages.size());
+    double encodeSeconds = 1e30, decodeSeconds = 1e30;
+    for (int r = 0; r < repeat; ++r)
+    {
+        auto start = Clock::now();
+        for (size_t i = 0; i < messages.size(); ++i)
+            encoded[i] = Codec::Encode(messages[i]);
+        encodeSeconds = std::min(encodeSeconds, std::chrono::duration<double>(Clock::now() - start).count());
+
+        std::vector<T> decoded(messages.size());
+        start = Clock::now();
+        for (size_t i = 0; i < messages.size(); ++i)
+            result.ok &= Codec::Decode(encoded[i], decoded[i]);
+        decodeSeconds = std::min(decodeSeconds, std::chrono::duration<double>(Clock::now() - start).count());
+        result.ok &= decoded == messages;
+    }
+
+    for (const auto& e : encoded)
+        result.size += e.size();
+    result.encodeMBps = result.size / encodeSeconds / 1e6;
+    result.decodeMBps = result.size / decodeSeconds / 1e6;
+    result.peak = size_t(zs::Instrumentation::peakBytes - base);
+    return result;
+}
+
+template<typename T>
+void Workload(const char* name, const std::vector<T>& messages, int repeat)
+{
+    auto print = [name](const char* codec, const Result& r)
+    {
+        std::printf("| %-22s | %-12s | %10.1f | %10.1f | %12zu | %12zu | %-4s |\n",
+            name, codec, r.encodeMBps, r.decodeMBps, r.size, r.peak, r.ok ? "yes" : "NO");
+    };
+    print(ZSerializerCodec::name, Run<ZSerializerCodec>(messages, repeat));
+#if defined(ZS_COMPARE_BOOST)
+    print(BoostCodec::name, Run<BoostCodec>(messages, repeat));
+#endif
+}
+
+Node MakeTree(int depth)
+{
+    Node node{ depth, {} };
+    if (depth > 0)
+        for (int i = 0; i < 3; ++i)
+            node.children.push_back(MakeTree(depth - 1));
+    return node;
+}
+
+int main()
+{
+    std::vector<State> states;
+    for (int i = 0; i < 100000; ++i)
+        states.push_back(State{ "player" + std::to_string(i % 64), float(i % 100), {i * 0.5f, 1.f, -2.f}, {0.f, 0.f, 1.f} });
+
+    std::vector<std::vector<float>> floats(1);
+    for (int i = 0; i < 1000000; ++i)
+        floats[0].push_back(i * 0.25f);
+
+    std::vector<std::vector<Record>> records(1);
+    for (int i = 0; i < 20000; ++i)
+        records[0].push_back(Record{ "user " + std::to_string(i), "user" + std::to_string(i) + "@example.com",
+            std::to_string(i) + " Main Street, Springfield", {"alpha", "beta", "gamma " + std::to_string(i % 10)} });
+
+    std::vector<Node> trees{ MakeTree(10) };
+
+    std::printf("| %-22s | %-12s | %10s | %10s | %12s | %12s | %-4s |\n",
+        "workload", "codec", "enc MB/s", "dec MB/s", "size", "peak heap", "ok");
+    std::printf("|%s|%s|%s|%s|%s|%s|%s|\n",
+        "------------------------", "--------------", "------------", "------------", "--------------", "--------------", "------");
+    Workload("100k State messages", states, 5);
+    Workload("1M float vector", floats, 5);
+    Workload("20k string records", records, 5);
+    Workload("3-ary tree depth 10", trees, 5);
+}
@@ -0,0 +1,202 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+// ZS_INSTRUMENT changes definitions in ZSerializer.hpp, so these tests are a binary of their own
+#define ZS_INSTRUMENT
+#include "../ZSerializer.hpp"
+#include "../ZSerializerIntern.hpp"
+#include <array>
+#include <memory_resource>
+
+ZS_COUNTING_NEW
+
+struct Vec3
+{
+    float x, y, z;
+    bool operator ==(const Vec3&) const = default;
+};
+
+struct State
+{
+    std::string name;
+    float hp;
+    Vec3 pos;
+    Vec3 vel;
+    bool operator ==(const State&) const = default;
+};
+
+namespace zs
+{
+    template<>
+    struct Trait<Vec3>
+    {
+        static constexpr auto members = std::make_tuple(&Vec3::x, &Vec3::y, &Vec3::z);
+    };
+
+    template<>
+    struct Trait<State> : public WriteMembers<State>, public ReadMembers<State>
+    {
+        static constexpr auto members = std::make_tuple(&State::name, &State::hp, &State::pos, &State::vel);
+    };
+}
+
+template<typename T, typename In>
+void Check(In& in, T target)
+{
+    auto result = zs::Read<T>(in);
+    REQUIRE(std::holds_alternative<T>(result));
+    REQUIRE(std::get<T>(result) == target);
+}
+
+TEST_CASE("instrumentation")
+{
+    zs::Instrumentation::Reset();
+
+    State state{ "a name too long for small string optimization", 99.f, {3.f,10.f,99.f}, {1.4f,0.f,3.f} };
+    zs::StringWriter out;
+    zs::InstrumentedWrite(out, state);
+    zs::InstrumentedWrite(out, state);
+
+    zs::StringReader in(out.String());
+    REQUIRE(std::holds_alternative<State>(zs::InstrumentedRead<State>(in)));
+    REQUIRE(std::holds_alternative<State>(zs::InstrumentedRead<State>(in)));
+    REQUIRE(std::holds_alternative<zs::Error>(zs::InstrumentedRead<State>(in)));
+
+    auto stats = zs::Instrumentation::Snapshot();
+    auto entry = std::find_if(stats.begin(), stats.end(), [](const zs::TypeStats& s){ return s.type == typeid(State).name(); });
+    REQUIRE(entry != stats.end());
+    REQUIRE(entry->write.calls == 2);
+    REQUIRE(entry->write.bytes == out.String().size());
+    REQUIRE(entry->read.calls == 3);
+    REQUIRE(entry->read.allocations >= 2);
+    REQUIRE(entry->read.allocatedBytes >= 2 * state.name.size());
+}
+
+TEST_CASE("instrumentation keeps stream capabilities")
+{
+    State state{ "a name too long for small string optimization", 99.f, {3.f,10.f,99.f}, {1.4f,0.f,3.f} };
+    std::vector<State> states(8, state);
+
+    zs::BufferWriter plainBytes;
+    zs::InterningWriter plain(plainBytes);
+    zs::Write(plain, states);
+
+    zs::BufferWriter countedBytes;
+    zs::InterningWriter counted(countedBytes);
+    zs::InstrumentedWrite(counted, states);
+    REQUIRE(countedBytes.buffer == plainBytes.buffer);
+
+    zs::BufferReader bytes(countedBytes.buffer);
+    zs::InterningReader in(bytes);
+    auto result = zs::InstrumentedRead<std::vector<State>>(in);
+    REQUIRE(std::holds_alternative<std::vector<State>>(result));
+    REQUIRE(std::get<std::vector<State>>(result) == states);
+}
+
+TEST_CASE("buffer pool")
+{
+    zs::BufferPool::Clear();
+    State state{ "tom", 99.f, {3.f,10.f,99.f}, {1.4f,0.f,3.f} };
+    auto encode = [&state]
+    {
+        zs::PooledWriter out;
+        zs::Write(out, state);
+        zs::BufferReader in(out.View());
+        Check(in, state);
+    };
+
+    encode();
+    auto allocations = zs::Instrumentation::allocations;
+    for (int i = 0; i < 100; ++i)
+        encode();
+    REQUIRE(zs::Instrumentation::allocations == allocations);
+
+    auto stats = zs::BufferPool::Stats();
+    REQUIRE(stats.acquired == 101);
+    REQUIRE(stats.reused == 100);
+    REQUIRE(stats.cached == 1);
+    REQUIRE(stats.cachedBytes >= 39);
+
+    {
+        zs::PooledWriter big;
+        big.buffer.resize(zs::BufferPool::maxBufferBytes + 1);
+    }
+    REQUIRE(zs::BufferPool::Stats().discarded == 1);
+    REQUIRE(zs::BufferPool::Stats().cached == 0);
+}
+
+struct Inventory
+{
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    Inventory(allocator_type allocator = {}):owner(allocator), items(allocator){}
+    Inventory(const Inventory& other, allocator_type allocator = {}):owner(other.owner, allocator), items(other.items, allocator){}
+    Inventory(Inventory&&) = default;
+    Inventory& operator =(const Inventory&) = default;
+
+    std::pmr::string owner;
+    std::pmr::vector<std::pmr::string> items;
+    std::optional<std::pmr::string> note;
+};
+
+namespace zs
+{
+    template<>
+    struct Trait<Inventory> : public WriteMembers<Inventory>, public ReadMembers<Inventory>
+    {
+        static constexpr auto members = std::make_tuple(&Inventory::owner, &Inventory::items, &Inventory::note);
+    };
+}
+
+TEST_CASE("memory resource")
+{
+    std::vector<std::string> items;
+    for (int i = 0; i < 50; ++i)
+        items.push_back("an item name long enough to need the heap #" + std::to_string(i));
+
+    zs::BufferWriter out;
+    zs::Write(out, items);
+    zs::Write(out, std::string("a fairly long owner name, long enough"));
+    zs::Write(out, items);
+    zs::Write(out, std::optional<std::string>("a note that does not fit in a small string"));
+
+    std::array<std::byte, 16 * 1024> arena;
+    std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size(), std::pmr::null_memory_resource());
+    zs::BufferReader bytes(out.buffer);
+    zs::ResourceReader in(bytes, &resource);
+
+    auto allocations = zs::Instrumentation::allocations;
+    auto vector = zs::Read<std::pmr::vector<std::pmr::string>>(in);
+    auto inventory = zs::Read<Inventory>(in);
+    REQUIRE(zs::Instrumentation::allocations == allocations);
+
+    REQUIRE(std::holds_alternative<std::pmr::vector<std::pmr::string>>(vector));
+    auto& strings = std::get<std::pmr::vector<std::pmr::string>>(vector);
+    REQUIRE(strings.size() == items.size());
+    REQUIRE(strings.get_allocator().resource() == &resource);
+    REQUIRE(std::string_view(strings[7]) == items[7]);
+    REQUIRE(strings[7].get_allocator().resource() == &resource);
+
+    REQUIRE(std::holds_alternative<Inventory>(inventory));
+    auto& result = std::get<Inventory>(inventory);
+    REQUIRE(result.owner == "a fairly long owner name, long enough");
+    REQUIRE(result.owner.get_allocator().resource() == &resource);
+    REQUIRE(std::string_view(result.items.back()) == items.back());
+    REQUIRE(result.items.back().get_allocator().resource() == &resource);
+    REQUIRE(*result.note == "a note that does not fit in a small string");
+
+    std::array<std::byte, 8 * 1024> instrumentedArena;
+    std::pmr::monotonic_buffer_resource instrumentedResource(instrumentedArena.data(), instrumentedArena.size(), std::pmr::null_memory_resource());
+    zs::BufferReader instrumentedBytes(out.buffer);
+    zs::ResourceReader instrumentedIn(instrumentedBytes, &instrumentedResource);
+    auto instrumented = zs::InstrumentedRead<std::pmr::vector<std::pmr::string>>(instrumentedIn);
+    REQUIRE(std::holds_alternative<std::pmr::vector<std::pmr::string>>(instrumented));
+    auto& instrumentedStrings = std::get<std::pmr::vector<std::pmr::string>>(instrumented);
+    REQUIRE(instrumentedStrings.get_allocator().resource() == &instrumentedResource);
+    REQUIRE(instrumentedStrings.back().get_allocator().resource() == &instrumentedResource);
+
+    zs::BufferWriter again;
+    zs::Write(again, strings);
+    zs::BufferReader plain(again.buffer);
+    Check(plain, items);
+}
@@ -2,6 +2,17 @@
 #include "catch2/catch.hpp"
 
 #include "../ZSerializer.hpp"
+#include "../ZSerializerParallel.hpp"
+#include "../ZSerializerRing.hpp"
+#include "../ZSerializerResumable.hpp"
+#include "../ZSerializerAsync.hpp"
+#include "../ZSerializerFrame.hpp"
+#include "../ZSerializerIovec.hpp"
+#include "../ZSerializerUring.hpp"
+#include "../ZSerializerCompress.hpp"
+#include "../ZSerializerIntern.hpp"
+#include "../ZSerializerChecksum.hpp"
+#include <sys/socket.h>
 #include <cstdint>
 #include <sstream>
 #include <tuple>
@@ -14,6 +25,17 @@ struct Vec3
     bool operator ==(const Vec3&) const = default;
 };
 
+namespace zs
+{
+    template<>
+    struct Trait<Vec3>
+    {
+        static constexpr auto name = "Vec3";
+        static constexpr std::array names{ "x", "y", "z" };
+        static constexpr auto members = std::make_tuple(&Vec3::x, &Vec3::y, &Vec3::z);
+    };
+}
+
 struct State
 {
     std::string name;
@@ -96,6 +118,8 @@ namespace zs
     template<>
     struct Trait<State> : public WriteMembers<State>, public ReadMembers<State>
     {
+        static constexpr auto name = "State";
+        static constexpr std::array names{ "name", "hp", "pos", "vel" };
         static constexpr auto members = std::make_tuple
         (
             &State::name,
@@ -156,4 +180,1218 @@ TEST_CASE("array")
     Check(in, std::array<float, 3>{10.f, 12.f, 33.f});
     Check(in, std::array<std::string, 2>{"lazy", "dog"});
     Check(in, std::array<State, 16>{State{ "Jerry", 12.f,{0,0,0},{0,0,1} }});
-}
\ No newline at end of file
+}
+
+struct Tint
+{
+    uint8_t id;
+    float color[3];
+};
+
+namespace zs
+{
+    template<>
+    struct Trait<Tint>
+    {
+        static constexpr auto members = std::make_tuple(&Tint::id, &Tint::color);
+    };
+}
+
+TEST_CASE("delta")
+{
+    State baseline{ "tom", 99.f, {3.f,10.f,99.f}, {1.4f,0.f,3.f} };
+    State current = baseline;
+    current.pos.y = 11.f;
+    current.hp = 98.f;
+
+    zs::StringWriter unchanged;
+    zs::WriteDelta(unchanged, baseline, baseline);
+    REQUIRE(unchanged.String().size() == 1);
+
+    zs::StringWriter out;
+    zs::WriteDelta(out, baseline, current);
+    REQUIRE(out.String().size() == 1 + sizeof(float) + 1 + sizeof(float));
+
+    zs::StringReader in(out.String());
+    auto result = zs::ReadDelta(in, baseline);
+    REQUIRE(std::holds_alternative<State>(result));
+    REQUIRE(std::get<State>(result) == current);
+
+    zs::StringReader truncated(out.String().substr(0, 3));
+    REQUIRE(std::holds_alternative<zs::Error>(zs::ReadDelta(truncated, baseline)));
+
+    Tint tint{ 7, {0.25f, 0.5f, 1.f} };
+    zs::StringWriter sameTint;
+    zs::WriteDelta(sameTint, tint, tint);
+    REQUIRE(sameTint.String().size() == 1);
+
+    Tint recolored = tint;
+    recolored.color[1] = 0.75f;
+    zs::StringWriter tintOut;
+    zs::WriteDelta(tintOut, tint, recolored);
+    REQUIRE(tintOut.String().size() == 1 + sizeof(recolored.color));
+    zs::StringReader tintIn(tintOut.String());
+    auto tintResult = zs::ReadDelta(tintIn, tint);
+    REQUIRE(std::holds_alternative<Tint>(tintResult));
+    REQUIRE(std::get<Tint>(tintResult).color[1] == 0.75f);
+}
+
+struct Packet
+{
+    bool reliable;
+    uint8_t channel;
+    int16_t delta;
+    std::optional<uint16_t> ack;
+    std::string payload;
+    bool operator ==(const Packet&) const = default;
+};
+
+namespace zs
+{
+    template<>
+    struct Trait<Packet> : public WriteMembers<Packet>, public ReadMembers<Packet>
+    {
+        static constexpr auto members = std::make_tuple
+        (
+            &Packet::reliable,
+            Bits<3>(&Packet::channel),
+            Bits<10>(&Packet::delta),
+            &Packet::ack,
+            &Packet::payload
+        );
+    };
+}
+
+enum class Turn : int8_t
+{
+    Left = -1,
+    None = 0,
+    Right = 1,
+};
+
+struct Steer
+{
+    Turn turn = Turn::None;
+    int8_t trim = 0;
+    bool operator ==(const Steer&) const = default;
+};
+
+namespace zs
+{
+    template<>
+    struct Trait<Steer> : public WriteMembers<Steer>, public ReadMembers<Steer>
+    {
+        static constexpr auto members = std::make_tuple(Bits<2>(&Steer::turn), Bits<4>(&Steer::trim));
+    };
+}
+
+TEST_CASE("bit packing")
+{
+    Packet packet{ true, 5, -300, 4321, "hello" };
+
+    zs::StringWriter out;
+    zs::BitWriter bits(out);
+    zs::Write(bits, packet);
+    zs::Write(bits, std::optional<Vec3>{});
+    bits.WriteBits(0x123456789abcdefull, 61);
+    bits.Flush();
+    // packed members and optional tag, size and payload at full width, empty optional tag, raw bits
+    REQUIRE(out.String().size() == (31 + 64 + 40 + 1 + 61 + 7) / 8);
+
+    zs::StringReader in(out.String());
+    zs::BitReader reader(in);
+    Check(reader, packet);
+    Check(reader, std::optional<Vec3>{});
+    uint64_t value;
+    REQUIRE(reader.ReadBits(value, 61));
+    REQUIRE(value == 0x123456789abcdefull);
+    REQUIRE(!reader.ReadBits(value, 8));
+
+    // signed enums are sign extended like signed integers
+    zs::StringWriter steerOut;
+    zs::BitWriter steerBits(steerOut);
+    zs::Write(steerBits, Steer{ Turn::Left, -3 });
+    zs::Write(steerBits, Steer{ Turn::Right, 7 });
+    steerBits.Flush();
+    REQUIRE(steerOut.String().size() == 2);
+    zs::StringReader steerIn(steerOut.String());
+    zs::BitReader steerReader(steerIn);
+    Check(steerReader, Steer{ Turn::Left, -3 });
+    Check(steerReader, Steer{ Turn::Right, 7 });
+
+    zs::StringWriter bytes;
+    zs::Write(bytes, packet);
+    zs::StringReader bytesIn(bytes.String());
+    Check(bytesIn, packet);
+}
+
+struct Quat
+{
+    float x, y, z, w;
+};
+
+struct Snapshot
+{
+    Vec3 pos;
+    Vec3 vel;
+    float heading;
+    Quat rot;
+    std::vector<Vec3> path;
+};
+
+namespace zs
+{
+    template<>
+    struct Trait<Quat>
+    {
+        static constexpr auto members = std::make_tuple(&Quat::x, &Quat::y, &Quat::z, &Quat::w);
+    };
+
+    template<>
+    struct Trait<Snapshot> : public WriteMembers<Snapshot>, public ReadMembers<Snapshot>
+    {
+        static constexpr auto members = std::make_tuple
+        (
+            Quantized<16>(&Snapshot::pos, -512.f, 512.f),
+            Half(&Snapshot::vel),
+            Quantized<9>(&Snapshot::heading, 0.f, 360.f),
+            SmallestThree<10>(&Snapshot::rot),
+            Quantized<16>(&Snapshot::path, -512.f, 512.f)
+        );
+    };
+}
+
+void CheckSnapshot(const Snapshot& source, const Snapshot& result)
+{
+    float step = 1024.f / 65535.f;
+    REQUIRE(std::fabs(result.pos.x - source.pos.x) <= step);
+    REQUIRE(std::fabs(result.pos.y - source.pos.y) <= step);
+    REQUIRE(std::fabs(result.pos.z - source.pos.z) <= step);
+    REQUIRE(result.vel == source.vel);
+    REQUIRE(std::fabs(result.heading - source.heading) <= 360.f / 511.f);
+    float dot = result.rot.x * source.rot.x + result.rot.y * source.rot.y + result.rot.z * source.rot.z + result.rot.w * source.rot.w;
+    REQUIRE(std::fabs(dot) > 0.999f);
+    REQUIRE(result.path.size() == source.path.size());
+    for (size_t i = 0; i < source.path.size(); ++i)
+    {
+        REQUIRE(std::fabs(result.path[i].x - source.path[i].x) <= step);
+        REQUIRE(std::fabs(result.path[i].z - source.path[i].z) <= step);
+    }
+}
+
+TEST_CASE("quantization")
+{
+    Snapshot snapshot{ {3.f, -200.5f, 511.f}, {1.5f, -0.25f, 8.f}, 123.4f, {0.5f, -0.5f, 0.5f, -0.5f}, {} };
+    for (int i = 0; i < 37; ++i)
+        snapshot.path.push_back({ i * 13.7f - 250.f, i * 0.1f, -i * 3.3f });
+
+    zs::StringWriter out;
+    zs::Write(out, snapshot);
+    REQUIRE(out.String().size() == 6 + 6 + 2 + 4 + 8 + 37 * 6);
+    zs::StringReader in(out.String());
+    auto result = zs::Read<Snapshot>(in);
+    REQUIRE(std::holds_alternative<Snapshot>(result));
+    CheckSnapshot(snapshot, std::get<Snapshot>(result));
+
+    zs::StringWriter packedOut;
+    zs::BitWriter bits(packedOut);
+    zs::Write(bits, snapshot);
+    bits.Flush();
+    REQUIRE(packedOut.String().size() == (48 + 48 + 9 + 32 + 64 + 37 * 48 + 7) / 8);
+    zs::StringReader packedIn(packedOut.String());
+    zs::BitReader reader(packedIn);
+    auto packed = zs::Read<Snapshot>(reader);
+    REQUIRE(std::holds_alternative<Snapshot>(packed));
+    CheckSnapshot(snapshot, std::get<Snapshot>(packed));
+
+    Snapshot moved = snapshot;
+    moved.pos.x += 5.f;
+    moved.rot = { 0.5f, 0.5f, 0.5f, 0.5f };
+    zs::StringWriter delta;
+    zs::WriteDelta(delta, snapshot, moved);
+    REQUIRE(delta.String().size() == 1 + 6 + 4);
+    zs::StringReader deltaIn(delta.String());
+    auto deltaResult = zs::ReadDelta(deltaIn, snapshot);
+    REQUIRE(std::holds_alternative<Snapshot>(deltaResult));
+    CheckSnapshot(moved, std::get<Snapshot>(deltaResult));
+}
+
+TEST_CASE("bulk quantization")
+{
+    std::vector<float> source;
+    for (int i = 0; i < 101; ++i)
+        source.push_back(i * 0.37f - 20.f);
+    source[5] = 1000.f;
+    source[6] = -1000.f;
+    source[7] = std::nanf("");
+
+    std::vector<uint16_t> q(source.size());
+    zs::QuantizeFloats(source.data(), q.data(), source.size(), -10.f, 10.f, 12);
+    std::vector<float> dest(source.size());
+    zs::DequantizeFloats(q.data(), dest.data(), dest.size(), -10.f, 10.f, 12);
+    for (size_t i = 0; i < source.size(); ++i)
+    {
+        REQUIRE(q[i] == zs::QuantizeFloat(source[i], -10.f, 10.f, 12));
+        REQUIRE(dest[i] == zs::DequantizeFloat(q[i], -10.f, 10.f, 12));
+    }
+    REQUIRE(q[5] == 4095);
+    REQUIRE(q[6] == 0);
+    REQUIRE(q[7] == 0);
+
+    REQUIRE(zs::HalfToFloat(zs::FloatToHalf(1.5f)) == 1.5f);
+    REQUIRE(zs::HalfToFloat(zs::FloatToHalf(-65504.f)) == -65504.f);
+    REQUIRE(zs::HalfToFloat(zs::FloatToHalf(1e-7f)) == std::ldexp(2.f, -24));
+    REQUIRE(std::isinf(zs::HalfToFloat(zs::FloatToHalf(1e6f))));
+}
+
+struct BigEndianWriter : zs::StringWriter
+{
+    static constexpr std::endian endian = std::endian::big;
+};
+
+struct BigEndianReader : zs::StringReader
+{
+    using StringReader::StringReader;
+    static constexpr std::endian endian = std::endian::big;
+};
+
+TEST_CASE("wire endian")
+{
+    zs::StringWriter little;
+    zs::Write(little, uint32_t(0x01020304));
+    REQUIRE(little.String() == "\x04\x03\x02\x01"s);
+
+    std::vector<uint16_t> shorts;
+    std::vector<double> doubles;
+    for (int i = 0; i < 19; ++i)
+    {
+        shorts.push_back(uint16_t(i * 3001));
+        doubles.push_back(i * -1.25);
+    }
+
+    BigEndianWriter out;
+    zs::Write(out, uint32_t(0x01020304));
+    zs::Write(out, std::array<float, 3>{10.f, 12.f, 33.f});
+    zs::Write(out, shorts);
+    zs::Write(out, doubles);
+    zs::Write(out, State{ "tom", 99.f, {3.f,10.f,99.f}, {1.4f,0.f,3.f} });
+    REQUIRE(out.String().substr(0, 4) == "\x01\x02\x03\x04"s);
+    REQUIRE(out.String().substr(4 + 12, 8) == "\0\0\0\0\0\0\0\x13"s);
+
+    BigEndianReader in(out.String());
+    Check(in, uint32_t(0x01020304));
+    Check(in, std::array<float, 3>{10.f, 12.f, 33.f});
+    Check(in, shorts);
+    Check(in, doubles);
+    Check(in, State{ "tom", 99.f, {3.f,10.f,99.f}, {1.4f,0.f,3.f} });
+
+    // POD structs with a Trait are swapped member by member, alone, in arrays and in vectors
+    BigEndianWriter pods;
+    zs::Write(pods, Vec3{ 1.f, 2.f, -2.f });
+    zs::Write(pods, std::array<Vec3, 2>{ Vec3{ 1.f, 0.f, 0.f }, Vec3{ 0.f, 2.f, 0.f } });
+    zs::Write(pods, std::vector<Vec3>(20, Vec3{ 0.f, 0.f, 1.f }));
+    zs::Write(pods, State{ "tom", 99.f, {1.f,10.f,99.f}, {} });
+    REQUIRE(pods.String().substr(0, 12) == "\x3f\x80\0\0\x40\0\0\0\xc0\0\0\0"s);
+    REQUIRE(pods.String().substr(12 + 24 + 8 + 8, 4) == "\x3f\x80\0\0"s);
+    REQUIRE(pods.String().substr(12 + 24 + 8 + 240 + 8 + 3 + 4, 4) == "\x3f\x80\0\0"s);
+    BigEndianReader podsIn(pods.String());
+    Check(podsIn, Vec3{ 1.f, 2.f, -2.f });
+    Check(podsIn, std::array<Vec3, 2>{ Vec3{ 1.f, 0.f, 0.f }, Vec3{ 0.f, 2.f, 0.f } });
+    Check(podsIn, std::vector<Vec3>(20, Vec3{ 0.f, 0.f, 1.f }));
+    Check(podsIn, State{ "tom", 99.f, {1.f,10.f,99.f}, {} });
+
+    std::vector<uint32_t> words{ 0x01020304, 0x05060708, 0x090a0b0c, 0x0d0e0f10, 0x11121314 };
+    zs::ByteSwapRange(words.data(), words.size());
+    REQUIRE(words == std::vector<uint32_t>{ 0x04030201, 0x08070605, 0x0c0b0a09, 0x100f0e0d, 0x14131211 });
+    std::vector<uint64_t> longs{ 0x0102030405060708, 0x1112131415161718, 0x2122232425262728 };
+    zs::ByteSwapRange(longs.data(), longs.size());
+    REQUIRE(longs == std::vector<uint64_t>{ 0x0807060504030201, 0x1817161514131211, 0x2827262524232221 });
+}
+
+TEST_CASE("instrumentation compiled out")
+{
+    State state{ "tom", 99.f, {3.f,10.f,99.f}, {1.4f,0.f,3.f} };
+    zs::StringWriter out;
+    zs::InstrumentedWrite(out, state);
+    zs::StringWriter plain;
+    zs::Write(plain, state);
+    REQUIRE(out.String() == plain.String());
+
+    zs::StringReader in(out.String());
+    Check(in, state);
+    zs::StringReader again(out.String());
+    REQUIRE(std::get<State>(zs::InstrumentedRead<State>(again)) == state);
+    REQUIRE(zs::Instrumentation::Snapshot().empty());
+}
+
+TEST_CASE("field profile")
+{
+    zs::FieldProfile profile;
+    zs::StringWriter out;
+    zs::ProfilingWriter writer(out, profile);
+    writer.Profile(State{ "tom", 99.f, {3.f,10.f,99.f}, {1.4f,0.f,3.f} });
+    writer.Profile(State{ "jerry", 12.f, {0.f,0.f,0.f}, {0.f,0.f,1.f} });
+    writer.Profile(Packet{ true, 5, -300, 4321, "hello" });
+
+    zs::StringWriter plain;
+    zs::Write(plain, State{ "tom", 99.f, {3.f,10.f,99.f}, {1.4f,0.f,3.f} });
+    zs::Write(plain, State{ "jerry", 12.f, {0.f,0.f,0.f}, {0.f,0.f,1.f} });
+    zs::Write(plain, Packet{ true, 5, -300, 4321, "hello" });
+    REQUIRE(out.String() == plain.String());
+
+    REQUIRE(profile.fields["State"].bytes == 39 + 41);
+    REQUIRE(profile.fields["State"].count == 2);
+    REQUIRE(profile.fields["State.name"].bytes == 8 + 3 + 8 + 5);
+    REQUIRE(profile.fields["State.pos"].bytes == 24);
+    REQUIRE(profile.fields["State.pos.x"].bytes == 8);
+    REQUIRE(profile.fields[zs::TypeName<Packet>() + ".1"].bytes == 1);
+
+    auto sorted = profile.Sorted();
+    REQUIRE(sorted.front().first == "State");
+    REQUIRE(sorted[1].first == "State.name");
+
+    std::ostringstream report;
+    profile.Report(report);
+    REQUIRE(report.str().find("State.vel.z\t8 bytes") != std::string::npos);
+
+    zs::FieldProfile internedProfile;
+    zs::BufferWriter internedBytes;
+    zs::InterningWriter interned(internedBytes);
+    zs::ProfilingWriter internedWriter(interned, internedProfile);
+    internedWriter.Profile(State{ "tom", 99.f, {3.f,10.f,99.f}, {1.4f,0.f,3.f} });
+    internedWriter.Profile(State{ "tom", 12.f, {0.f,0.f,0.f}, {0.f,0.f,1.f} });
+
+    zs::BufferWriter plainInternedBytes;
+    zs::InterningWriter plainInterned(plainInternedBytes);
+    zs::Write(plainInterned, State{ "tom", 99.f, {3.f,10.f,99.f}, {1.4f,0.f,3.f} });
+    zs::Write(plainInterned, State{ "tom", 12.f, {0.f,0.f,0.f}, {0.f,0.f,1.f} });
+    REQUIRE(internedBytes.buffer == plainInternedBytes.buffer);
+    REQUIRE(internedProfile.fields["State.name"].bytes == 3 + 3);
+}
+
+TEST_CASE("parallel write")
+{
+    std::vector<State> states;
+    for (int i = 0; i < 10001; ++i)
+        states.push_back(State{ "npc" + std::to_string(i), float(i), {1.f, 2.f, float(i)}, {0.f, 0.f, 1.f} });
+
+    zs::BufferWriter serial;
+    zs::WriteParallel(serial, states, { 1000, 1 });
+    zs::BufferWriter parallel;
+    zs::WriteParallel(parallel, states, { 1000, 4 });
+    REQUIRE(serial.buffer == parallel.buffer);
+
+    zs::BufferReader in(parallel.buffer);
+    Check(in, states.size());
+    Check(in, size_t(1000));
+    size_t total = 0;
+    for (int i = 0; i < 11; ++i)
+    {
+        auto size = zs::Read<size_t>(in);
+        REQUIRE(std::holds_alternative<size_t>(size));
+        total += std::get<size_t>(size);
+    }
+    REQUIRE(total == parallel.buffer.size() - in.offset);
+    for (const auto& state : states)
+        Check(in, state);
+
+    zs::BufferWriter floats;
+    zs::WriteParallel(floats, std::vector<float>(2500, 1.5f), { 1000, 4 });
+    REQUIRE(floats.buffer.size() == 2 * 8 + 3 * 8 + 2500 * 4);
+}
+
+struct World
+{
+    uint32_t tick;
+    std::vector<State> entities;
+    std::vector<Vec3> points;
+    bool operator ==(const World&) const = default;
+};
+
+namespace zs
+{
+    template<>
+    struct Trait<World> : public WriteMembers<World>, public ReadMembers<World>
+    {
+        static constexpr auto members = std::make_tuple
+        (
+            &World::tick,
+            Chunked(&World::entities, 100),
+            Chunked(&World::points, 100)
+        );
+    };
+}
+
+TEST_CASE("parallel read")
+{
+    std::vector<State> states;
+    for (int i = 0; i < 5003; ++i)
+        states.push_back(State{ "npc" + std::to_string(i), float(i), {1.f, 2.f, float(i)}, {0.f, 0.f, 1.f} });
+
+    zs::BufferWriter out;
+    zs::WriteParallel(out, states, { 500, 4 });
+    zs::WriteParallel(out, std::vector<double>(1234, 0.5), { 100, 4 });
+
+    zs::BufferReader in(out.buffer);
+    auto result = zs::ReadParallel<State>(in, { 500, 4 });
+    REQUIRE(std::holds_alternative<std::vector<State>>(result));
+    REQUIRE(std::get<std::vector<State>>(result) == states);
+    auto doubles = zs::ReadParallel<double>(in);
+    REQUIRE(std::holds_alternative<std::vector<double>>(doubles));
+    REQUIRE(std::get<std::vector<double>>(doubles) == std::vector<double>(1234, 0.5));
+
+    zs::BufferReader truncated(std::string_view(out.buffer).substr(0, out.buffer.size() / 2));
+    REQUIRE(std::holds_alternative<zs::Error>(zs::ReadParallel<State>(truncated)));
+
+    // forged headers are rejected before anything is allocated for them
+    zs::BufferWriter forged;
+    zs::Write(forged, size_t(1) << 40);
+    zs::Write(forged, size_t(1) << 20);
+    zs::BufferReader forgedIn(forged.buffer);
+    REQUIRE(std::get<zs::Error>(zs::ReadParallel<State>(forgedIn)).kind == zs::ErrorKind::TooLarge);
+    zs::BufferWriter forgedBytes;
+    zs::Write(forgedBytes, size_t(1));
+    zs::Write(forgedBytes, size_t(1));
+    zs::Write(forgedBytes, size_t(1) << 62);
+    zs::BufferReader forgedBytesIn(forgedBytes.buffer);
+    REQUIRE(std::get<zs::Error>(zs::ReadParallel<State>(forgedBytesIn)).kind == zs::ErrorKind::TooLarge);
+    zs::BufferWriter forgedPod;
+    zs::Write(forgedPod, (size_t(1) << 61) + 1);
+    zs::Write(forgedPod, size_t(1) << 62);
+    zs::Write(forgedPod, size_t(8));
+    zs::BufferReader forgedPodIn(forgedPod.buffer);
+    REQUIRE(std::holds_alternative<zs::Error>(zs::ReadParallel<double>(forgedPodIn)));
+
+    // a forged string size inside an element fails its chunk instead of throwing on a worker
+    zs::BufferWriter forgedElement;
+    zs::WriteParallel(forgedElement, std::vector<State>(4, states[0]), { 1, 4 });
+    size_t second = 6 * sizeof(size_t) + (forgedElement.buffer.size() - 6 * sizeof(size_t)) / 4;
+    size_t forgedSize = size_t(1) << 63;
+    std::memcpy(forgedElement.buffer.data() + second, &forgedSize, sizeof(forgedSize));
+    zs::BufferReader forgedElementIn(forgedElement.buffer);
+    auto forgedResult = zs::ReadParallel<State>(forgedElementIn, { 1, 4 });
+    REQUIRE(std::holds_alternative<zs::Error>(forgedResult));
+    REQUIRE(std::get<zs::Error>(forgedResult).kind == zs::ErrorKind::TooLarge);
+    REQUIRE(std::get<zs::Error>(forgedResult).Path() == "[1]");
+
+    BigEndianWriter big;
+    zs::WriteParallel(big, std::vector<std::string>(100, "chunked"), { 30, 4 });
+    BigEndianReader bigIn(big.String());
+    REQUIRE(std::get<std::vector<std::string>>(zs::ReadParallel<std::string>(bigIn, { 30, 4 })) == std::vector<std::string>(100, "chunked"));
+    REQUIRE(big.String().substr(16 + 4 * 8, 8) == "\0\0\0\0\0\0\0\x07"s);
+
+    World world{ 7, states, std::vector<Vec3>(345, Vec3{ 1.f, 2.f, 3.f }) };
+    zs::BufferWriter worldOut;
+    zs::Write(worldOut, world);
+    zs::BufferReader worldIn(worldOut.buffer);
+    Check(worldIn, world);
+}
+
+TEST_CASE("batch encode")
+{
+    std::vector<State> states;
+    for (int i = 0; i < 3001; ++i)
+        states.push_back(State{ std::string(i % 40, 'n'), float(i), {1.f, 2.f, float(i)}, {0.f, 0.f, 1.f} });
+
+    zs::WorkStealingPool pool(4);
+    auto buffers = zs::EncodeBatch(pool, states);
+    REQUIRE(buffers.size() == states.size());
+    for (size_t i = 0; i < states.size(); ++i)
+    {
+        zs::BufferReader in(buffers[i]);
+        Check(in, states[i]);
+        REQUIRE(in.offset == buffers[i].size());
+    }
+
+    auto packed = zs::EncodeBatch(pool, std::vector<Packet>(100, Packet{ true, 5, -300, 4321, "hello" }), [](auto& out, const Packet& packet)
+    {
+        zs::BitWriter bits(out);
+        zs::Write(bits, packet);
+        bits.Flush();
+    });
+    REQUIRE(packed.size() == 100);
+    REQUIRE(packed.back().size() == 17);
+
+    std::atomic<size_t> sum{ 0 };
+    pool.ParallelFor(10000, [&sum](size_t i){ sum += i; }, 7);
+    REQUIRE(sum == 10000 * 9999 / 2);
+
+    REQUIRE_THROWS_AS(pool.ParallelFor(100, [](size_t i){ if (i == 42) throw std::runtime_error("failed"); }), std::runtime_error);
+    pool.ParallelFor(10, [&sum](size_t){ ++sum; });
+    REQUIRE(sum == 10000 * 9999 / 2 + 10);
+}
+
+TEST_CASE("spsc ring")
+{
+    zs::SpscRing ring(1024);
+    std::vector<State> received;
+    {
+        zs::RingConsumer consumer(ring, [&received](std::string_view record)
+        {
+            zs::BufferReader in(record);
+            auto state = zs::Read<State>(in);
+            REQUIRE(std::holds_alternative<State>(state));
+            REQUIRE(in.offset == record.size());
+            received.push_back(std::get<State>(state));
+        });
+        for (int i = 0; i < 5000; ++i)
+            while (!zs::Publish(ring, State{ std::string(i % 23, 'x'), float(i), {}, {} }))
+                std::this_thread::yield();
+    }
+    REQUIRE(received.size() == 5000);
+    for (int i = 0; i < 5000; ++i)
+        REQUIRE(received[i].hp == float(i));
+
+    REQUIRE(!zs::Publish(ring, std::string(2000, 'x')));
+    REQUIRE(ring.Dropped() > 0);
+}
+
+TEST_CASE("mpsc ring")
+{
+    zs::MpscRing ring(256);
+    std::vector<std::vector<uint32_t>> received(4);
+    {
+        zs::RingConsumer consumer(ring, [&received](std::string_view record)
+        {
+            zs::BufferReader in(record);
+            auto message = std::get<uint64_t>(zs::Read<uint64_t>(in));
+            received[message >> 32].push_back(uint32_t(message));
+        });
+        std::vector<std::thread> producers;
+        for (uint32_t p = 0; p < 4; ++p)
+            producers.emplace_back([&ring, p]
+            {
+                for (uint32_t i = 0; i < 3000; ++i)
+                    while (!zs::Publish(ring, uint64_t(p) << 32 | i))
+                        std::this_thread::yield();
+            });
+        for (auto& producer : producers)
+            producer.join();
+    }
+    for (const auto& messages : received)
+    {
+        REQUIRE(messages.size() == 3000);
+        for (uint32_t i = 0; i < 3000; ++i)
+            REQUIRE(messages[i] == i);
+    }
+}
+
+TEST_CASE("ring to file")
+{
+    FILE* file = std::tmpfile();
+    REQUIRE(file);
+    zs::MpscRing ring(256);
+    {
+        zs::RingConsumer consumer(ring, zs::FdSink{ fileno(file) });
+        for (int i = 0; i < 100; ++i)
+            while (!zs::Publish(ring, State{ "tom", float(i), {}, {} }))
+                std::this_thread::yield();
+    }
+    std::string contents(size_t(std::ftell(file)), '\0');
+    std::rewind(file);
+    REQUIRE(std::fread(contents.data(), 1, contents.size(), file) == contents.size());
+    std::fclose(file);
+
+    zs::BufferReader in(contents);
+    for (int i = 0; i < 100; ++i)
+        Check(in, State{ "tom", float(i), {}, {} });
+}
+
+struct Node
+{
+    int value;
+    std::vector<Node> children;
+};
+
+namespace zs
+{
+    template<>
+    struct Trait<Node> : public WriteMembers<Node>, public ReadMembers<Node>
+    {
+        static constexpr auto members = std::make_tuple(&Node::value, &Node::children);
+    };
+}
+
+TEST_CASE("incremental read")
+{
+    State state{ "a name that needs its own allocation", 99.f, {3.f,10.f,99.f}, {1.4f,0.f,3.f} };
+    zs::BufferWriter out;
+    zs::Write(out, state);
+    zs::Write(out, state);
+    std::string first = out.buffer.substr(0, out.buffer.size() / 2);
+
+    zs::IncrementalReader<State> reader;
+    for (size_t i = 0; i + 1 < first.size(); ++i)
+    {
+        char byte = first[i];
+        REQUIRE(reader.Feed(std::string_view(&byte, 1)) == zs::ReadStatus::NeedMore);
+    }
+    REQUIRE(reader.Feed(std::string_view(out.buffer).substr(first.size() - 1, 20)) == zs::ReadStatus::Done);
+    REQUIRE(reader.Value() == state);
+    REQUIRE(reader.Rest().size() == 19);
+
+    std::string rest(reader.Rest());
+    reader.Reset();
+    REQUIRE(reader.Feed(rest) == zs::ReadStatus::NeedMore);
+    REQUIRE(reader.Feed(std::string_view(out.buffer).substr(first.size() + 19)) == zs::ReadStatus::Done);
+    REQUIRE(reader.Value() == state);
+    REQUIRE(reader.Rest().empty());
+
+    reader.Reset();
+    REQUIRE(reader.Feed(std::string_view(first).substr(0, 30)) == zs::ReadStatus::NeedMore);
+    REQUIRE(reader.Finish() == zs::ReadStatus::Failed);
+
+    reader.Reset();
+    REQUIRE(reader.Feed(std::string_view(first).substr(0, 30)) == zs::ReadStatus::NeedMore);
+    reader.Reset();
+    REQUIRE(reader.Feed(first) == zs::ReadStatus::Done);
+    REQUIRE(reader.Value() == state);
+
+    // a chain nested deeper than the decoder stack allows fails instead of running into the guard page
+    zs::BufferWriter chain;
+    for (int depth = 0; depth < 20000; ++depth)
+    {
+        zs::Write(chain, depth);
+        zs::Write(chain, size_t(1));
+    }
+    zs::Write(chain, 0);
+    zs::Write(chain, size_t(0));
+    zs::IncrementalReader<Node> nodes;
+    REQUIRE(nodes.Feed(chain.buffer) == zs::ReadStatus::Failed);
+    REQUIRE(nodes.Failure().kind == zs::ErrorKind::TooLarge);
+    nodes.Reset();
+    zs::BufferWriter shallow;
+    zs::Write(shallow, Node{ 1, { Node{ 2, {} } } });
+    REQUIRE(nodes.Feed(shallow.buffer) == zs::ReadStatus::Done);
+    REQUIRE(nodes.Value().children[0].value == 2);
+}
+
+zs::Task<bool> WriteStates(zs::EpollStream& out, const std::vector<State>& states, const State& single)
+{
+    co_return co_await zs::AsyncWrite(out, states) && co_await zs::AsyncWrite(out, single);
+}
+
+zs::Task<bool> ReadStates(zs::EpollStream& in, const std::vector<State>& states, const State& single)
+{
+    auto many = co_await zs::AsyncRead<std::vector<State>>(in);
+    auto one = co_await zs::AsyncRead<State>(in);
+    co_return std::get<std::vector<State>>(many) == states && std::get<State>(one) == single;
+}
+
+TEST_CASE("async read write")
+{
+    std::vector<State> states(50000, State{ "async", 1.f, {1.f,2.f,3.f}, {4.f,5.f,6.f} });
+    State single{ "single", 2.f, {}, {} };
+
+    SECTION("socketpair")
+    {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        {
+            zs::EventLoop loop;
+            zs::EpollStream a(loop, fds[0]);
+            zs::EpollStream b(loop, fds[1]);
+
+            auto writes = WriteStates(a, states, single);
+            auto reads = ReadStates(b, states, single);
+            writes.Start();
+            reads.Start();
+            loop.RunUntil([&] { return writes.Done() && reads.Done(); });
+            REQUIRE(writes.Result());
+            REQUIRE(reads.Result());
+        }
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    SECTION("pipe")
+    {
+        int fds[2];
+        REQUIRE(pipe(fds) == 0);
+        zs::EventLoop loop;
+        zs::EpollStream in(loop, fds[0]);
+        zs::EpollStream out(loop, fds[1]);
+
+        auto write = zs::AsyncWrite(out, single);
+        auto read = zs::AsyncRead<State>(in);
+        auto truncated = zs::AsyncRead<State>(in);
+        read.Start();
+        write.Start();
+        loop.RunUntil([&] { return write.Done() && read.Done(); });
+        REQUIRE(write.Result());
+        REQUIRE(std::get<State>(read.Result()) == single);
+
+        auto partial = out.Write(std::string_view("\x05\0\0", 3));
+        partial.Start();
+        REQUIRE(partial.Done());
+        REQUIRE(partial.Result());
+        close(fds[1]);
+        truncated.Start();
+        loop.RunUntil([&] { return truncated.Done(); });
+        REQUIRE(std::holds_alternative<zs::Error>(truncated.Result()));
+        // the hung up pipe is no longer watched, so it cannot keep waking the loop
+        epoll_event event;
+        REQUIRE(epoll_wait(loop.fd_, &event, 1, 0) == 0);
+        close(fds[0]);
+    }
+}
+
+TEST_CASE("varint")
+{
+    for (uint64_t value : { 0ull, 1ull, 127ull, 128ull, 300ull, 1ull << 35, ~0ull })
+    {
+        zs::BufferWriter out;
+        zs::WriteVarint(out, value);
+        uint64_t decoded;
+        REQUIRE(zs::DecodeVarint(out.buffer, decoded) == out.buffer.size());
+        REQUIRE(decoded == value);
+        zs::BufferReader in(out.buffer);
+        REQUIRE(zs::ReadVarint(in, decoded));
+        REQUIRE(decoded == value);
+        REQUIRE(zs::DecodeVarint(std::string_view(out.buffer).substr(0, out.buffer.size() - 1), decoded) == 0);
+    }
+}
+
+TEST_CASE("framing")
+{
+    REQUIRE(zs::Crc32c(0, "123456789", 9) == 0xe3069283);
+
+    State state{ "framed", 1.f, {1.f,2.f,3.f}, {} };
+    zs::BufferWriter out;
+    for (int i = 0; i < 100; ++i)
+    {
+        state.hp = float(i);
+        zs::FrameOptions options;
+        if (i % 2)
+            options.type = i;
+        options.checksum = i % 3 == 0;
+        zs::WriteFramed(out, state, options);
+    }
+    zs::WriteFrame(out, "raw"sv);
+
+    std::vector<zs::Frame> frames;
+    REQUIRE(std::get<size_t>(zs::ParseFrames(out.buffer, frames)) == out.buffer.size());
+    REQUIRE(frames.size() == 101);
+    for (int i = 0; i < 100; ++i)
+    {
+        REQUIRE(frames[i].type == (i % 2 ? std::optional<uint64_t>(i) : std::nullopt));
+        REQUIRE(std::get<State>(zs::ReadFrame<State>(frames[i])).hp == float(i));
+    }
+    REQUIRE(frames[100].payload == "raw");
+
+    zs::FrameReceiver receiver;
+    std::vector<zs::Frame> received;
+    size_t count = 0;
+    for (size_t offset = 0; offset < out.buffer.size(); offset += 77)
+    {
+        auto space = receiver.Space();
+        size_t bytes = std::min<size_t>(77, out.buffer.size() - offset);
+        std::memcpy(space.data(), out.buffer.data() + offset, bytes);
+        receiver.Commit(bytes);
+        received.clear();
+        count += std::get<size_t>(receiver.Extract(received));
+        for (auto& frame : received)
+            REQUIRE((frame.payload == "raw" || std::get<State>(zs::ReadFrame<State>(frame)).name == "framed"));
+    }
+    REQUIRE(count == 101);
+
+    std::string corrupt = out.buffer;
+    corrupt[frames[0].payload.data() - out.buffer.data()] ^= 1;
+    frames.clear();
+    REQUIRE(std::holds_alternative<zs::Error>(zs::ParseFrames(corrupt, frames)));
+    REQUIRE(frames.empty());
+
+    // payloads keep the plain encoding ReadFrame expects whatever the byte order or capabilities of out
+    BigEndianWriter big;
+    zs::WriteFramed(big, uint32_t(0x01020304));
+    zs::WriteFramed(big, uint32_t(0x01020304), { .type = std::nullopt, .checksum = true });
+    zs::BufferWriter internedBytes;
+    zs::InterningWriter interned(internedBytes);
+    zs::WriteFramed(interned, state);
+    zs::WriteFramed(interned, state);
+    std::string bigFrames = big.String();
+    frames.clear();
+    REQUIRE(std::get<size_t>(zs::ParseFrames(bigFrames, frames)) == bigFrames.size());
+    REQUIRE(std::get<uint32_t>(zs::ReadFrame<uint32_t>(frames[0])) == 0x01020304);
+    REQUIRE(std::get<uint32_t>(zs::ReadFrame<uint32_t>(frames[1])) == 0x01020304);
+    frames.clear();
+    REQUIRE(std::get<size_t>(zs::ParseFrames(internedBytes.buffer, frames)) == internedBytes.buffer.size());
+    REQUIRE(frames.size() == 2);
+    REQUIRE(std::get<State>(zs::ReadFrame<State>(frames[1])) == state);
+}
+
+TEST_CASE("iovec writer")
+{
+    State state{ "small", 1.f, {1.f,2.f,3.f}, {} };
+    std::vector<uint8_t> blob(3 << 20);
+    for (size_t i = 0; i < blob.size(); ++i)
+        blob[i] = uint8_t(i * 31);
+
+    zs::BufferWriter expected;
+    zs::Write(expected, state);
+    zs::Write(expected, blob);
+    zs::Write(expected, state);
+
+    zs::IovecWriter out(1024, 64);
+    for (int round = 0; round < 2; ++round)
+    {
+        out.Clear();
+        zs::Write(out, state);
+        zs::Write(out, blob);
+        zs::Write(out, state);
+        REQUIRE(out.Size() == expected.buffer.size());
+
+        auto iovecs = out.Iovecs();
+        REQUIRE(std::count_if(iovecs.begin(), iovecs.end(), [&](const iovec& v) { return v.iov_base == blob.data(); }) == 1);
+        std::string gathered;
+        for (auto& v : iovecs)
+            gathered.append(static_cast<const char*>(v.iov_base), v.iov_len);
+        REQUIRE(gathered == expected.buffer);
+    }
+
+    FILE* file = std::tmpfile();
+    REQUIRE(out.WriteTo(fileno(file)));
+    std::string written(expected.buffer.size(), '\0');
+    std::rewind(file);
+    REQUIRE(std::fread(written.data(), 1, written.size(), file) == written.size());
+    std::fclose(file);
+    REQUIRE(written == expected.buffer);
+}
+
+TEST_CASE("uring file")
+{
+    std::vector<State> states(20000, State{ "uring", 1.f, {1.f,2.f,3.f}, {4.f,5.f,6.f} });
+    for (size_t i = 0; i < states.size(); ++i)
+        states[i].hp = float(i);
+
+    for (bool uring : { true, false })
+    {
+        FILE* file = std::tmpfile();
+        int fd = fileno(file);
+        REQUIRE(::write(fd, "head", 4) == 4);
+
+        zs::UringOptions options;
+        options.bufferBytes = 4096;
+        options.buffers = 3;
+        options.uring = uring;
+        {
+            zs::UringWriter out(fd, options);
+            if (!uring)
+                REQUIRE(!out.UsingUring());
+            zs::Write(out, states);
+            zs::Write(out, 42);
+            REQUIRE(out.Flush());
+        }
+        zs::SizeWriter size;
+        zs::Write(size, states);
+        REQUIRE(lseek(fd, 0, SEEK_CUR) == off_t(4 + size.size + 4));
+
+        REQUIRE(lseek(fd, 4, SEEK_SET) == 4);
+        {
+            zs::UringReader in(fd, options);
+            REQUIRE(std::get<std::vector<State>>(zs::Read<std::vector<State>>(in)) == states);
+            REQUIRE(std::get<int>(zs::Read<int>(in)) == 42);
+            REQUIRE(std::holds_alternative<zs::Error>(zs::Read<int>(in)));
+        }
+
+        REQUIRE(lseek(fd, 4, SEEK_SET) == 4);
+        {
+            zs::UringReader in(fd, options);
+            REQUIRE(std::holds_alternative<std::vector<State>>(zs::Read<std::vector<State>>(in)));
+        }
+        REQUIRE(lseek(fd, 0, SEEK_CUR) == off_t(4 + size.size));
+        std::fclose(file);
+    }
+}
+
+TEST_CASE("block compression")
+{
+    std::string mixed;
+    for (int i = 0; i < 20000; ++i)
+        mixed += std::to_string(i * 7919 % 1000) + (i % 3 ? "aaaaaaaaaaaaaaaaaaaaaaa" : "b");
+    std::string noise(100000, '\0');
+    uint32_t seed = 1;
+    for (auto& c : noise)
+        c = char((seed = seed * 1103515245 + 12345) >> 16);
+    for (const std::string& raw : { ""s, "a"s, "abcabcabcabcabcabcabc"s, std::string(1000, 'z'), mixed, noise })
+    {
+        std::string compressed(zs::LzBound(raw.size()), '\0');
+        compressed.resize(zs::LzCompress(raw.data(), raw.size(), compressed.data()));
+        std::string decompressed(raw.size(), '\0');
+        REQUIRE(zs::LzDecompress(compressed.data(), compressed.size(), decompressed.data(), raw.size()));
+        REQUIRE(decompressed == raw);
+        if (raw.size() > 100)
+            REQUIRE(!zs::LzDecompress(compressed.data(), compressed.size() / 2, decompressed.data(), raw.size()));
+    }
+
+    std::vector<State> states(5000, State{ "compressed", 1.f, {1.f,2.f,3.f}, {4.f,5.f,6.f} });
+    for (size_t i = 0; i < states.size(); ++i)
+        states[i].hp = float(i % 10);
+    zs::BufferWriter plain;
+    zs::Write(plain, states);
+
+    zs::BufferWriter out;
+    zs::CompressWriter compress(out, 4096);
+    zs::Write(compress, states);
+    zs::Write(compress, noise);
+    compress.Flush();
+    REQUIRE(out.buffer.size() < plain.buffer.size() / 4 + noise.size() + 1000);
+
+    zs::BufferReader in(out.buffer);
+    zs::DecompressReader decompress(in);
+    REQUIRE(std::get<std::vector<State>>(zs::Read<std::vector<State>>(decompress)) == states);
+    REQUIRE(std::get<std::string>(zs::Read<std::string>(decompress)) == noise);
+    REQUIRE(std::holds_alternative<zs::Error>(zs::Read<char>(decompress)));
+
+    std::string corrupt = out.buffer;
+    corrupt[100] ^= 0x5a;
+    zs::BufferReader corruptIn(corrupt);
+    zs::DecompressReader corruptDecompress(corruptIn);
+    auto result = zs::Read<std::vector<State>>(corruptDecompress);
+    REQUIRE((std::holds_alternative<zs::Error>(result) || std::get<std::vector<State>>(result) != states));
+}
+
+TEST_CASE("dictionary compression")
+{
+    const char* names[] = { "tom", "jerry", "spike", "tyke" };
+    auto sample = [&](int i)
+    {
+        return State{ names[i % 4], float(i % 100), {float(i % 7), 10.f, 0.f}, {1.5f, 0.f, float(i % 3)} };
+    };
+    std::vector<std::string> corpus;
+    for (int i = 0; i < 500; ++i)
+    {
+        zs::BufferWriter out;
+        zs::Write(out, sample(i));
+        corpus.push_back(out.buffer);
+    }
+    zs::LzDictionary dictionary = zs::TrainDictionary(corpus, 1024);
+    REQUIRE(!dictionary.content.empty());
+    REQUIRE(dictionary.content.size() <= 1024);
+
+    size_t plainBytes = 0, withoutBytes = 0, withBytes = 0;
+    for (int i = 1000; i < 1100; ++i)
+    {
+        State state = sample(i);
+        zs::BufferWriter plain, without, with;
+        zs::Write(plain, state);
+        zs::WriteCompressed(without, state, zs::LzDictionary{});
+        zs::WriteCompressed(with, state, dictionary);
+        plainBytes += plain.buffer.size();
+        withoutBytes += without.buffer.size();
+        withBytes += with.buffer.size();
+
+        zs::BufferReader in(with.buffer);
+        REQUIRE(std::get<State>(zs::ReadCompressed<State>(in, dictionary)) == state);
+        zs::BufferReader mismatched(with.buffer);
+        auto result = zs::ReadCompressed<State>(mismatched, zs::LzDictionary{});
+        REQUIRE((std::holds_alternative<zs::Error>(result) || std::get<State>(result) != state));
+    }
+    REQUIRE(withBytes * 2 < plainBytes);
+    REQUIRE(withBytes * 2 < withoutBytes);
+
+    zs::BufferWriter blocks;
+    zs::CompressWriter compress(blocks, 64, &dictionary);
+    for (int i = 0; i < 100; ++i)
+        zs::Write(compress, sample(i));
+    compress.Flush();
+    zs::BufferReader in(blocks.buffer);
+    zs::DecompressReader decompress(in, 1024, &dictionary);
+    for (int i = 0; i < 100; ++i)
+        REQUIRE(std::get<State>(zs::Read<State>(decompress)) == sample(i));
+}
+
+struct Tag
+{
+    std::string_view key;
+    int value;
+};
+
+namespace zs
+{
+    template<>
+    struct Trait<Tag> : public WriteMembers<Tag>, public ReadMembers<Tag>
+    {
+        static constexpr auto members = std::make_tuple(&Tag::key, &Tag::value);
+    };
+}
+
+TEST_CASE("string interning")
+{
+    const char* names[] = { "tom", "jerry", "a much longer name that does not fit in a small string buffer" };
+    std::vector<State> states;
+    for (int i = 0; i < 3000; ++i)
+        states.push_back(State{ names[i % 3], float(i), {}, {} });
+
+    zs::BufferWriter plain;
+    zs::Write(plain, states);
+    zs::BufferWriter out;
+    zs::InterningWriter interning(out);
+    zs::Write(interning, states);
+    zs::Write(interning, "tom");
+    REQUIRE(out.buffer.size() < plain.buffer.size() * 2 / 3);
+
+    {
+        zs::BufferReader in(out.buffer);
+        zs::InterningReader reader(in);
+        REQUIRE(std::get<std::vector<State>>(zs::Read<std::vector<State>>(reader)) == states);
+        REQUIRE(std::get<std::string>(zs::Read<std::string>(reader)) == "tom");
+    }
+
+    {
+        zs::BufferReader in(out.buffer);
+        zs::InterningReader interned(in);
+        zs::ResourceReader reader(interned, std::pmr::new_delete_resource());
+        REQUIRE(std::get<std::vector<State>>(zs::Read<std::vector<State>>(reader)) == states);
+    }
+
+    std::vector<Tag> tags;
+    for (int i = 0; i < 100; ++i)
+        tags.push_back(Tag{ names[i % 3], i });
+    zs::BufferWriter tagOut;
+    zs::InterningWriter tagInterning(tagOut);
+    zs::Write(tagInterning, tags);
+
+    zs::BufferReader tagIn(tagOut.buffer);
+    zs::InterningReader tagReader(tagIn);
+    auto read = std::get<std::vector<Tag>>(zs::Read<std::vector<Tag>>(tagReader));
+    REQUIRE(read.size() == 100);
+    for (int i = 0; i < 100; ++i)
+    {
+        REQUIRE(read[i].key == names[i % 3]);
+        REQUIRE(read[i].value == i);
+        REQUIRE(read[i].key.data() == read[i % 3].key.data());
+    }
+
+    std::string bad = "\x07";
+    zs::BufferReader badIn(bad);
+    zs::InterningReader badReader(badIn);
+    REQUIRE(std::holds_alternative<zs::Error>(zs::Read<std::string>(badReader)));
+}
+
+TEST_CASE("checksum")
+{
+    std::string data(100003, '\0');
+    uint32_t seed = 7;
+    for (auto& c : data)
+        c = char((seed = seed * 1103515245 + 12345) >> 16);
+    REQUIRE(zs::Crc32cSoftware(0, "123456789", 9) == 0xe3069283);
+    for (size_t size : { 0, 1, 7, 8, 9, 63, 1000, 100003 })
+    {
+        uint32_t whole = zs::Crc32c(0, data.data(), size);
+        REQUIRE(zs::Crc32cSoftware(0, data.data(), size) == whole);
+        REQUIRE(zs::Crc32c(zs::Crc32c(0, data.data(), size / 3), data.data() + size / 3, size - size / 3) == whole);
+    }
+
+    State state{ "checked", 5.f, {1.f,2.f,3.f}, {} };
+    zs::BufferWriter out;
+    zs::ChecksumWriter checked(out);
+    zs::Write(checked, state);
+    checked.Finish();
+    zs::Write(checked, data);
+    checked.Finish();
+    {
+        zs::BufferReader in(out.buffer);
+        zs::ChecksumReader verified(in);
+        REQUIRE(std::get<State>(zs::Read<State>(verified)) == state);
+        REQUIRE(verified.Verify());
+        REQUIRE(std::get<std::string>(zs::Read<std::string>(verified)) == data);
+        REQUIRE(verified.Verify());
+    }
+    {
+        std::string corrupt = out.buffer;
+        corrupt[10] ^= 1;
+        zs::BufferReader in(corrupt);
+        zs::ChecksumReader verified(in);
+        zs::Read<State>(verified);
+        REQUIRE(!verified.Verify());
+    }
+
+    zs::BufferWriter blocks;
+    zs::CheckedBlockWriter blockWriter(blocks, 4096);
+    zs::Write(blockWriter, state);
+    zs::Write(blockWriter, data);
+    blockWriter.Flush();
+    {
+        zs::BufferReader in(blocks.buffer);
+        zs::CheckedBlockReader reader(in);
+        REQUIRE(std::get<State>(zs::Read<State>(reader)) == state);
+        REQUIRE(std::get<std::string>(zs::Read<std::string>(reader)) == data);
+        REQUIRE(std::holds_alternative<zs::Error>(zs::Read<char>(reader)));
+    }
+    {
+        std::string corrupt = blocks.buffer;
+        corrupt[5000] ^= 1;
+        zs::BufferReader in(corrupt);
+        zs::CheckedBlockReader reader(in);
+        REQUIRE(std::get<State>(zs::Read<State>(reader)) == state);
+        REQUIRE(std::holds_alternative<zs::Error>(zs::Read<std::string>(reader)));
+    }
+}
+
+TEST_CASE("error details")
+{
+    std::vector<State> states{ State{ "tom", 1.f, {}, {} }, State{ "jerry", 2.f, {1.f,2.f,3.f}, {4.f,5.f,6.f} } };
+    zs::BufferWriter out;
+    zs::Write(out, states);
+    {
+        std::string_view truncated(out.buffer.data(), out.buffer.size() - 2);
+        zs::BufferReader in(truncated);
+        auto result = zs::Read<std::vector<State>>(in);
+        REQUIRE(std::holds_alternative<zs::Error>(result));
+        auto& error = std::get<zs::Error>(result);
+        REQUIRE(error.kind == zs::ErrorKind::Truncated);
+        REQUIRE(error.offset == truncated.size());
+        REQUIRE(error.Path() == "[1].vel");
+        zs::Error copy = error;
+        REQUIRE(copy.Path() == error.Path());
+        REQUIRE(zs::Error(zs::ErrorKind::Checksum).Path().empty());
+        REQUIRE(error.Message() == "truncated input at byte " + std::to_string(truncated.size()) + " in [1].vel");
+    }
+    {
+        std::string_view truncated(out.buffer.data(), 25);
+        zs::BufferReader in(truncated);
+        auto result = zs::Read<std::vector<State>>(in);
+        REQUIRE(std::get<zs::Error>(result).Path() == "[0].pos");
+    }
+    {
+        zs::IncrementalReader<State> reader;
+        zs::BufferWriter single;
+        zs::Write(single, states[1]);
+        REQUIRE(reader.Feed(std::string_view(single.buffer).substr(0, 10)) == zs::ReadStatus::NeedMore);
+        REQUIRE(reader.Finish() == zs::ReadStatus::Failed);
+        REQUIRE(reader.Failure().kind == zs::ErrorKind::Truncated);
+        REQUIRE(reader.Failure().offset == 10);
+    }
+}
+
+TEST_CASE("read in place")
+{
+    std::vector<State> states{ State{ "tom", 1.f, {1.f,2.f,3.f}, {} }, State{ "jerry", 2.f, {}, {4.f,5.f,6.f} } };
+    std::optional<std::string> note = "note";
+    zs::BufferWriter out;
+    zs::Write(out, states);
+    zs::Write(out, note);
+    zs::Write(out, std::array<std::string, 2>{ "lazy", "dog" });
+
+    zs::BufferReader in(out.buffer);
+    std::vector<State> read{ State{ "stale", 0.f, {}, {} }, State{}, State{} };
+    REQUIRE(zs::Read(in, read));
+    REQUIRE(read == states);
+    std::optional<std::string> readNote;
+    REQUIRE(zs::Read(in, readNote));
+    REQUIRE(readNote == note);
+    std::array<std::string, 2> words;
+    REQUIRE(zs::Read(in, words));
+    REQUIRE(words[1] == "dog");
+
+    int missing;
+    REQUIRE(!zs::Read(in, missing));
+    REQUIRE(zs::LastError().kind == zs::ErrorKind::Truncated);
+    REQUIRE(zs::LastError().offset == out.buffer.size());
+
+    std::string_view truncated(out.buffer.data(), 30);
+    zs::BufferReader partial(truncated);
+    REQUIRE(!zs::Read(partial, read));
+    REQUIRE(zs::LastError().Path() == "[0].pos");
+}